@@ -28,7 +28,7 @@ namespace {
 			// We acquire a context specific to the thread we are on (PerThreadContext)
 			auto ptc = ifc.begin();
 			// We start building a rendergraph
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 			// The rendergraph is composed of passes (vuk::Pass)
 			// Each pass declares which resources are used
 			// And it provides a callback which is executed when this pass is being ran
@@ -58,7 +58,7 @@ namespace {
 			// For this example, we just request that all transfer finish before we continue
 			ptc.wait_all_transfers();
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 			rg.add_pass({
 				// For this example, only a color image is needed to write to (our framebuffer)
 				// The name is declared, and the way it will be used (color attachment - write)
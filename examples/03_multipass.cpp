@@ -54,7 +54,7 @@ namespace {
 			auto uboVP = buboVP;
 			ptc.wait_all_transfers();
 		
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 			// Add a pass to draw a triangle (from the first example) into the top left corner
 			rg.add_pass({
 				.resources = {"03_multipass_final"_image(vuk::eColorWrite)},
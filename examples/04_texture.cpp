@@ -61,7 +61,7 @@ namespace {
 			auto uboVP = buboVP;
 			ptc.wait_all_transfers();
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 
 			// Set up the pass to draw the textured cube, with a color and a depth attachment
 			rg.add_pass({
@@ -60,7 +60,7 @@ namespace {
 			auto uboVP = buboVP;
 			ptc.wait_all_transfers();
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 			// Here we will render the cube into 3 offscreen textures
 			rg.add_pass({
 				// Passes can be optionally named, this useful for visualization and debugging
@@ -68,7 +68,7 @@ namespace {
 			auto uboVP = buboVP;
 			ptc.wait_all_transfers();
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 
 			// The rendering pass is unchanged by going to multisampled, 
 			// but we will use an offscreen multisampled color attachment
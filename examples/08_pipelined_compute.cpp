@@ -73,7 +73,7 @@ namespace {
 		.render = [](vuk::ExampleRunner& runner, vuk::InflightContext& ifc) {
 			auto ptc = ifc.begin();
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 
 			// standard render to texture
 			rg.add_pass({
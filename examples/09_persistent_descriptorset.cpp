@@ -78,7 +78,7 @@ namespace {
 			ici.usage = vuk::ImageUsageFlagBits::eStorage | vuk::ImageUsageFlagBits::eSampled;
 			variant2 = ptc.allocate_texture(ici);
 			// Make a RenderGraph to process the loaded image
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 			rg.add_pass({
 						.name = "09_preprocess",
 						.resources = {"09_doge"_image(vuk::eMemoryRead), "09_v1"_image(vuk::eTransferDst), "09_v2"_image(vuk::eComputeRead)},
@@ -142,7 +142,7 @@ namespace {
 			auto uboVP = buboVP;
 			ptc.wait_all_transfers();
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 
 			// Set up the pass to draw the textured cube, with a color and a depth attachment
 			rg.add_pass({
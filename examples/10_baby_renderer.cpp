@@ -117,7 +117,7 @@ namespace {
 			ici.usage = vuk::ImageUsageFlagBits::eStorage | vuk::ImageUsageFlagBits::eSampled;
 			variant2 = ptc.allocate_texture(ici);
 			// Make a RenderGraph to process the loaded image
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 			rg.add_pass({
 						.name = "10_preprocess",
 						.resources = {"10_doge"_image(vuk::eMemoryRead), "10_v1"_image(vuk::eTransferDst), "10_v2"_image(vuk::eComputeRead)},
@@ -261,7 +261,7 @@ namespace {
 				memcpy(reinterpret_cast<glm::mat4*>(modelmats.mapped_ptr) + i, &model_matrix, sizeof(glm::mat4));
 			}
 
-			vuk::RenderGraph rg;
+			vuk::RenderGraph rg(ifc);
 
 			// Set up the pass to draw the renderables
 			rg.add_pass({
@@ -0,0 +1,51 @@
+#include "vuk/RenderGraph.hpp"
+#include "vuk/ShortAlloc.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* benchmark_compile
+* Compiles synthetic rendergraphs of 10, 100, 1k and 10k compute passes, to see how RenderGraph::compile scales
+* Pass i writes buffer i and reads buffers i - 1 and i / 2; every 8th pass also writes buffer i - 1 (a write-after-write)
+* Compiling needs no Context, so this runs without a device
+* Heap allocations per compile are only counted when vuk is built with VUK_COUNT_HEAP_ALLOCATIONS
+*/
+
+int main() {
+	for (size_t pass_count : { 10, 100, 1000, 10000 }) {
+		std::vector<std::string> names;
+		names.reserve(pass_count);
+		for (size_t i = 0; i < pass_count; i++) {
+			names.push_back("buffer" + std::to_string(i));
+		}
+
+		constexpr size_t iterations = 10;
+		double total_ms = 0;
+		size_t total_allocations = 0;
+		for (size_t it = 0; it < iterations; it++) {
+			vuk::RenderGraph rg;
+			for (size_t i = 0; i < pass_count; i++) {
+				vuk::Pass p;
+				p.resources.emplace_back(vuk::Resource(names[i], vuk::Resource::Type::eBuffer, vuk::eComputeWrite));
+				if (i > 0) {
+					p.resources.emplace_back(vuk::Resource(names[i - 1], vuk::Resource::Type::eBuffer, i % 8 == 0 ? vuk::eComputeWrite : vuk::eComputeRead));
+					if (i / 2 != i - 1) {
+						p.resources.emplace_back(vuk::Resource(names[i / 2], vuk::Resource::Type::eBuffer, vuk::eComputeRead));
+					}
+				}
+				rg.add_pass(std::move(p));
+			}
+			rg.attach_buffer(names.back(), vuk::Buffer{}, vuk::eNone, vuk::eComputeRead);
+
+			auto allocations = vuk::thread_heap_allocations();
+			auto start = std::chrono::high_resolution_clock::now();
+			rg.compile();
+			auto end = std::chrono::high_resolution_clock::now();
+			total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+			total_allocations += vuk::thread_heap_allocations() - allocations;
+		}
+		printf("%6zu passes: %10.3f ms, %8zu heap allocations per compile\n", pass_count, total_ms / iterations, total_allocations / iterations);
+	}
+	return 0;
+}
@@ -51,9 +51,17 @@ vuk::ExampleRunner::ExampleRunner() {
 			}
 			vkbdevice = dev_ret.value();
 			graphics_queue = vkbdevice.get_queue(vkb::QueueType::graphics).value();
+			auto graphics_queue_family_index = vkbdevice.get_queue_index(vkb::QueueType::graphics).value();
 			device = vkbdevice.device;
+			// use a dedicated compute queue for async compute if there is one
+			VkQueue compute_queue = VK_NULL_HANDLE;
+			uint32_t compute_queue_family_index = VK_QUEUE_FAMILY_IGNORED;
+			if (auto cq = vkbdevice.get_dedicated_queue(vkb::QueueType::compute); cq.has_value()) {
+				compute_queue = cq.value();
+				compute_queue_family_index = vkbdevice.get_dedicated_queue_index(vkb::QueueType::compute).value();
+			}
 
-			context.emplace(instance, device, physical_device, graphics_queue);
+			context.emplace(instance, device, physical_device, graphics_queue, graphics_queue_family_index, compute_queue, compute_queue_family_index);
 
 			swapchain = context->add_swapchain(util::make_swapchain(vkbdevice));
 }
@@ -100,7 +108,7 @@ void vuk::ExampleRunner::render() {
 			rg.attach_swapchain(attachment_name, swapchain, vuk::ClearColor{ 0.3f, 0.5f, 0.3f, 1.0f });
 			execute_submit_and_present_to_one(ptc, std::move(rg).link(ptc), swapchain);
 		} else { // render all examples as imgui windows
-			RenderGraph rg;
+			RenderGraph rg(ifc);
 			auto ptc = ifc.begin();
 			plf::colony<std::string> attachment_names;
 
@@ -51,9 +51,17 @@ vuk::ExampleRunner::ExampleRunner() {
 			}
 			vkbdevice = dev_ret.value();
 			graphics_queue = vkbdevice.get_queue(vkb::QueueType::graphics).value();
+			auto graphics_queue_family_index = vkbdevice.get_queue_index(vkb::QueueType::graphics).value();
 			device = vkbdevice.device;
+			// use a dedicated compute queue for async compute if there is one
+			VkQueue compute_queue = VK_NULL_HANDLE;
+			uint32_t compute_queue_family_index = VK_QUEUE_FAMILY_IGNORED;
+			if (auto cq = vkbdevice.get_dedicated_queue(vkb::QueueType::compute); cq.has_value()) {
+				compute_queue = cq.value();
+				compute_queue_family_index = vkbdevice.get_dedicated_queue_index(vkb::QueueType::compute).value();
+			}
 
-			context.emplace(instance, device, physical_device, graphics_queue);
+			context.emplace(instance, device, physical_device, graphics_queue, graphics_queue_family_index, compute_queue, compute_queue_family_index);
 
 			swapchain = context->add_swapchain(util::make_swapchain(vkbdevice));
 }
@@ -2,6 +2,7 @@
 
 #include <utility>
 #include <optional>
+#include <tuple>
 #include "Allocator.hpp"
 #include "FixedVector.hpp"
 #include "Types.hpp"
@@ -179,6 +180,10 @@ namespace vuk {
 			vuk::Extent2D extent;
 			vuk::SampleCountFlagBits samples;
 			std::span<const VkAttachmentReference> color_attachments;
+			// attachment formats, when rendering dynamically (renderpass is VK_NULL_HANDLE)
+			vuk::fixed_vector<VkFormat, VUK_MAX_COLOR_ATTACHMENTS> color_formats;
+			VkFormat depth_format = VK_FORMAT_UNDEFINED;
+			VkFormat stencil_format = VK_FORMAT_UNDEFINED;
 		};
 		std::optional<RenderPassInfo> ongoing_renderpass;
 		PassInfo* current_pass = nullptr;
@@ -197,6 +202,58 @@ namespace vuk {
 		std::array<SetBinding, VUK_MAX_SETS> set_bindings = {};
 		std::bitset<VUK_MAX_SETS> persistent_sets_used = {};
 		std::array<VkDescriptorSet, VUK_MAX_SETS> persistent_sets = {};
+		// while recording a static pass, descriptor sets are created for it and kept with its command buffer instead of coming from the per-frame cache
+		std::vector<DescriptorSet>* static_descriptor_sets = nullptr;
+		// offsets of the uniform buffers last bound to dynamic uniform buffer bindings
+		std::array<std::array<uint32_t, VUK_MAX_BINDINGS>, VUK_MAX_SETS> dynamic_offsets = {};
+
+		// state currently bound on the command buffer for a bind point, to skip redundant binds
+		struct BoundState {
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			VkPipelineLayout layout = VK_NULL_HANDLE;
+			size_t push_constant_hash = 0;
+			std::bitset<VUK_MAX_SETS> sets_valid = {};
+			std::array<VkDescriptorSetLayout, VUK_MAX_SETS> set_layouts = {};
+			std::array<VkDescriptorSet, VUK_MAX_SETS> sets = {};
+			std::bitset<VUK_MAX_SETS> persistent = {};
+			// SetBinding the set was acquired for and its hash, the hash only rejects quickly before the bindings are compared
+			std::array<size_t, VUK_MAX_SETS> set_hashes = {};
+			std::array<SetBinding, VUK_MAX_SETS> set_bindings = {};
+			// dynamic offsets the set was bound with
+			std::array<std::array<uint32_t, VUK_MAX_BINDINGS>, VUK_MAX_SETS> offsets = {};
+			std::array<uint32_t, VUK_MAX_SETS> offset_counts = {};
+		};
+		std::array<BoundState, 2> bound = {}; // graphics, compute
+		// everything a graphics pipeline instance is created from
+		struct PipelineInputs {
+			vuk::PipelineBaseInfo* base = nullptr;
+			vuk::PrimitiveTopology topology = vuk::PrimitiveTopology::eTriangleList;
+			VkRenderPass renderpass = VK_NULL_HANDLE;
+			uint32_t subpass = 0;
+			vuk::SampleCountFlagBits samples = {};
+			size_t color_attachment_count = 0;
+			vuk::fixed_vector<VkFormat, VUK_MAX_COLOR_ATTACHMENTS> color_formats;
+			VkFormat depth_format = VK_FORMAT_UNDEFINED;
+			VkFormat stencil_format = VK_FORMAT_UNDEFINED;
+			vuk::fixed_vector<vuk::VertexInputAttributeDescription, VUK_MAX_ATTRIBUTES> attribute_descriptions;
+			vuk::fixed_vector<VkVertexInputBindingDescription, VUK_MAX_ATTRIBUTES> binding_descriptions;
+			vuk::fixed_vector<std::pair<VkSpecializationMapEntry, VkShaderStageFlags>, VUK_MAX_SPECIALIZATIONCONSTANT_RANGES> smes;
+			std::array<unsigned char, 64> specialization_constants = {};
+
+			bool operator==(const PipelineInputs& o) const {
+				return std::tie(base, topology, renderpass, subpass, samples, color_attachment_count, color_formats, depth_format, stencil_format) ==
+				           std::tie(o.base, o.topology, o.renderpass, o.subpass, o.samples, o.color_attachment_count, o.color_formats, o.depth_format, o.stencil_format) &&
+				       attribute_descriptions == o.attribute_descriptions && binding_descriptions == o.binding_descriptions && smes == o.smes &&
+				       specialization_constants == o.specialization_constants;
+			}
+		};
+		// inputs current_pipeline was created from and their hash, the hash only rejects quickly before the inputs are compared
+		size_t current_pipeline_key = 0;
+		PipelineInputs current_pipeline_inputs;
+		// ranges pushed since the push constants were last disturbed, with pushed_constants holding their contents
+		vuk::fixed_vector<VkPushConstantRange, VUK_MAX_PUSHCONSTANT_RANGES> pushed_ranges;
+		std::array<unsigned char, 64> pushed_constants = {};
+		size_t pushed_layout_hash = 0;
 
 		// for rendergraph
 		CommandBuffer(ExecutableRenderGraph& rg, vuk::PerThreadContext& ptc, VkCommandBuffer cb) : rg(&rg), ptc(ptc), command_buffer(cb) {}
@@ -211,9 +268,20 @@ namespace vuk {
 			return ptc;
 		}
 		const RenderPassInfo& get_ongoing_renderpass() const;
+
+		/// @brief Pipeline, descriptor set and push constant binds recorded into this command buffer, and redundant ones skipped
+		struct BindStats {
+			size_t issued = 0;
+			size_t skipped = 0;
+		};
+		const BindStats& get_bind_stats() const {
+			return bind_stats;
+		}
 		vuk::Buffer get_resource_buffer(Name) const;
 		vuk::Image get_resource_image(Name) const;
 		vuk::ImageView get_resource_image_view(Name) const;
+		/// @brief View of mip levels [base_level, base_level + level_count) and array layers [base_layer, base_layer + layer_count) of an image, as used by a pass with Resource::mips and Resource::layers
+		vuk::ImageView get_resource_image_view(Name, uint32_t base_level, uint32_t level_count = 1, uint32_t base_layer = 0, uint32_t layer_count = VK_REMAINING_ARRAY_LAYERS) const;
 
 		CommandBuffer& set_viewport(unsigned index, Viewport vp);
 		CommandBuffer& set_viewport(unsigned index, Rect2D area, float min_depth = 0.f, float max_depth = 1.f);
@@ -255,6 +323,10 @@ namespace vuk {
 		CommandBuffer& bind_storage_image(unsigned set, unsigned binding, vuk::ImageView image_view);
 		CommandBuffer& bind_storage_image(unsigned set, unsigned binding, Name);
 
+		CommandBuffer& bind_input_attachment(unsigned set, unsigned binding, vuk::ImageView image_view, vuk::ImageLayout = vuk::ImageLayout::eShaderReadOnlyOptimal);
+		/// @brief Bind an attachment the current pass reads with eInputRead, for use as a subpassInput
+		CommandBuffer& bind_input_attachment(unsigned set, unsigned binding, Name);
+
 		void* _map_scratch_uniform_binding(unsigned set, unsigned binding, size_t size);
 
 		template<class T>
@@ -280,7 +352,15 @@ namespace vuk {
 		// explicit synchronisation
 		void image_barrier(Name, vuk::Access src_access, vuk::Access dst_access);
 	protected:
+		BindStats bind_stats;
+
 		void _bind_state(bool graphics);
+		/// @brief Record a pipeline switch on a bind point, keeping the descriptor sets and push constants that stay valid under its layout
+		void _switch_layout(BoundState& state, VkPipelineLayout layout, const std::array<DescriptorSetLayoutAllocInfo, VUK_MAX_SETS>& layout_info, size_t push_constant_hash);
+		/// @brief Everything bound on the command buffer is undefined after executing secondaries
+		void _invalidate_bound_state();
+		size_t _pipeline_key() const;
+		PipelineInputs _pipeline_inputs() const;
 		void _bind_compute_pipeline_state();
 		void _bind_graphics_pipeline_state();
 	};
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "vuk_fwd.hpp"
 #include "vuk/Pipeline.hpp"
@@ -16,6 +19,16 @@ namespace vuk {
 		size_t id;
 	};
 
+	/// @brief GPU time spent in a part of a profiled rendergraph execution, see ExecutableRenderGraph::enable_profiling
+	struct GPUTiming {
+		enum class Kind { ePass, eRenderPass, eBarriers } kind;
+		// pass name, name of the first pass for renderpasses, name of the pass the barriers precede or follow
+		std::string name;
+		double ms;
+		// for passes when pipeline statistics were requested, one value per requested VkQueryPipelineStatisticFlagBits in bit order
+		std::vector<uint64_t> pipeline_statistics;
+	};
+
 	class Context {
 	public:
 		constexpr static size_t FC = 3;
@@ -26,10 +39,39 @@ namespace vuk {
 		uint32_t graphics_queue_family_index;
 		VkQueue transfer_queue;
 		uint32_t transfer_queue_family_index;
+		// optional queue for async compute, rendergraphs route compute-only passes here
+		VkQueue compute_queue = VK_NULL_HANDLE;
+		uint32_t compute_queue_family_index = VK_QUEUE_FAMILY_IGNORED;
+		// timestampValidBits of the graphics and compute queue families, profiling skips the queues without timestamps
+		uint32_t graphics_timestamp_valid_bits = 0;
+		uint32_t compute_timestamp_valid_bits = 0;
+		// nanoseconds per timestamp tick
+		float timestamp_period = 0.f;
 
 		std::atomic<size_t> frame_counter = 0;
 
-		Context(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device, VkQueue graphics);
+		// VK_KHR_dynamic_rendering entry points, null if the extension is not enabled on the device
+		PFN_vkCmdBeginRenderingKHR cmdBeginRenderingKHR = nullptr;
+		PFN_vkCmdEndRenderingKHR cmdEndRenderingKHR = nullptr;
+		// link single-subpass renderpasses for dynamic rendering instead of creating VkRenderPasses and VkFramebuffers
+		// off by default: set it only if the extension and its dynamicRendering feature were enabled on the device
+		bool use_dynamic_rendering = false;
+		// VK_KHR_synchronization2 entry point, null if the extension is not enabled on the device
+		PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2KHR = nullptr;
+		// emit rendergraph barriers with vkCmdPipelineBarrier2, every barrier keeping its own (finer) stages, in one call per boundary
+		// off by default: set it only if the extension and its synchronization2 feature were enabled on the device
+		bool use_synchronization2 = false;
+		// VK_KHR_push_descriptor entry point, null if the extension is not enabled on the device
+		PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSetKHR = nullptr;
+		// when a pipeline picks no push_descriptor_set, push its highest set with at most this many single descriptors and no binding flags
+		// must not exceed maxPushDescriptors. 0 to only push the sets pipelines pick, as sets used with bind_persistent can't be pushed
+		uint32_t push_descriptor_max_bindings = 0;
+		// uniform buffers of pipeline layouts are created as dynamic uniform buffers, up to this many per layout. must not exceed maxDescriptorSetUniformBuffersDynamic
+		// their offset is passed when binding, so descriptor sets of uniform buffers differing only in offset (e.g. scratch uniforms) are shared
+		// 0 (the default) keeps plain uniform buffers, leave it there if sets with uniform buffers are used with bind_persistent
+		uint32_t max_dynamic_uniform_buffers = 0;
+
+		Context(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device, VkQueue graphics, uint32_t graphics_queue_family_index, VkQueue compute = VK_NULL_HANDLE, uint32_t compute_queue_family_index = VK_QUEUE_FAMILY_IGNORED);
 		~Context();
 
 		struct DebugUtils {
@@ -144,6 +186,14 @@ namespace vuk {
 
 		void submit_graphics(VkSubmitInfo, VkFence);
 		void submit_transfer(VkSubmitInfo, VkFence);
+		void submit_compute(VkSubmitInfo, VkFence);
+
+		/// @brief Check if compute work can run on a queue separate from graphics
+		bool has_async_compute() const;
+
+		/// @brief Timings of the profiled executions of the most recently read back frame
+		/// Queries are read back without waiting when their frame is recycled, so these lag FC frames behind
+		std::vector<GPUTiming> get_gpu_timings();
 	private:
 		struct ContextImpl* impl;
 		std::atomic<size_t> unique_handle_id_counter = 0;
@@ -151,6 +201,8 @@ namespace vuk {
 		void enqueue_destroy(VkPipeline);
 
 		void destroy(const struct RGImage& image);
+		void destroy(const struct TransientHeap& heap);
+		void destroy(const struct TransientBuffers& buffers);
 		void destroy(const struct PoolAllocator& v);
 		void destroy(const struct LinearAllocator& v);
 		void destroy(const DescriptorPool& dp);
@@ -174,6 +226,7 @@ namespace vuk {
 		friend class PerThreadContext;
 		friend struct IFCImpl;
 		friend struct PTCImpl;
+		friend struct RenderGraph;
 		template<class T> friend class Cache; // caches can directly destroy
 		template<class T, size_t FC> friend class PerFrameCache;
 	};
@@ -183,6 +236,8 @@ namespace vuk {
 		Context& ctx;
 		const size_t absolute_frame;
 		const unsigned frame;
+		// number of vkCmdPipelineBarrier calls recorded in this frame
+		std::atomic<size_t> pipeline_barrier_calls = 0;
 		InflightContext(Context& ctx, size_t absolute_frame, std::lock_guard<std::mutex>&& recycle_guard);
 		~InflightContext();
 
@@ -286,11 +341,19 @@ namespace vuk {
 		void destroy(vuk::DescriptorSet ds);
 
 		VkFence acquire_fence();
-		VkCommandBuffer acquire_command_buffer(VkCommandBufferLevel);
+		VkCommandBuffer acquire_command_buffer(VkCommandBufferLevel, Domain domain = Domain::eGraphics);
 		VkSemaphore acquire_semaphore();
+		VkEvent acquire_event();
+		/// @brief Query pools for a profiled rendergraph execution of this frame, with two timestamps (and optionally one statistics query) per scope
+		struct ProfiledExecution& acquire_profiled_execution(uint32_t scope_count, VkQueryPipelineStatisticFlags pipeline_statistics);
+		/// @brief Secondary command buffer of a static pass, kept across frames. One is kept per key, if none was recorded for this key, record is called with
+		/// a new command buffer and the descriptor sets that live as long as it. A new version releases the recordings of all keys, unused ones are released after a few frames
+		VkCommandBuffer acquire_static_pass(Name name, uint64_t version, size_t key, Domain domain, const std::function<void(VkCommandBuffer, std::vector<DescriptorSet>&)>& record);
 		VkFramebuffer acquire_framebuffer(const struct FramebufferCreateInfo&);
 		VkRenderPass acquire_renderpass(const struct RenderPassCreateInfo&);
 		RGImage acquire_rendertarget(const struct RGCI&);
+		TransientHeap acquire_transient_heap(const struct TransientHeapCreateInfo&);
+		TransientBuffers acquire_transient_buffers(const struct TransientBuffersCreateInfo&);
 		Sampler acquire_sampler(const SamplerCreateInfo&);
 		DescriptorSet acquire_descriptorset(const SetBinding&);
 		PipelineInfo acquire_pipeline(const PipelineInstanceCreateInfo&);
@@ -302,6 +365,8 @@ namespace vuk {
 		ShaderModule create(const struct ShaderModuleCreateInfo& cinfo);
 		VkRenderPass create(const struct RenderPassCreateInfo& cinfo);
 		RGImage create(const struct RGCI& cinfo);
+		TransientHeap create(const struct TransientHeapCreateInfo& cinfo);
+		TransientBuffers create(const struct TransientBuffersCreateInfo& cinfo);
 		LinearAllocator create(const struct PoolSelect& cinfo);
 		DescriptorPool create(const struct DescriptorSetLayoutAllocInfo& cinfo);
 		DescriptorSet create(const struct SetBinding& cinfo);
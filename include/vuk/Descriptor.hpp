@@ -2,6 +2,7 @@
 
 #define VUK_MAX_BINDINGS 16
 #include <bitset>
+#include <span>
 #include <vector>
 #include "vuk_fwd.hpp"
 #include "Types.hpp"
@@ -58,10 +59,18 @@ namespace vuk {
 
 	struct DescriptorSetLayoutAllocInfo {
 		std::array<uint32_t, 12> descriptor_counts = {};
-		VkDescriptorSetLayout layout;
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
 		unsigned variable_count_binding = (unsigned)-1;
 		vuk::DescriptorType variable_count_binding_type;
 		unsigned variable_count_binding_max_size;
+		// the layout was created for push descriptors: sets are recorded into command buffers, never allocated
+		bool push_descriptor = false;
+		// writes the bindings in template_mask from one DescriptorUpdateSlot per binding, in binding order
+		// null if the layout has arrays, binding flags or descriptors SetBinding can't hold
+		VkDescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+		uint32_t template_mask = 0;
+		// bindings that are dynamic uniform buffers, their offsets are given when binding the set
+		uint32_t dynamic_mask = 0;
 
 		bool operator==(const DescriptorSetLayoutAllocInfo& o) const {
 			return layout == o.layout && descriptor_counts == o.descriptor_counts;
@@ -100,12 +109,14 @@ namespace vuk {
 			if (type != o.type) return false;
 			switch (type) {
 			case vuk::DescriptorType::eUniformBuffer:
+			case vuk::DescriptorType::eUniformBufferDynamic:
 			case vuk::DescriptorType::eStorageBuffer:
 				return memcmp(&buffer, &o.buffer, sizeof(VkDescriptorBufferInfo)) == 0;
 			case vuk::DescriptorType::eStorageImage:
 			case vuk::DescriptorType::eSampledImage:
 			case vuk::DescriptorType::eSampler:
 			case vuk::DescriptorType::eCombinedImageSampler:
+			case vuk::DescriptorType::eInputAttachment:
 				return image == o.image;
 			default:
 				assert(0);
@@ -114,11 +125,22 @@ namespace vuk {
 		}
 	};
 #pragma pack(pop)
+	// packed descriptor info read by descriptor update templates
+	union DescriptorUpdateSlot {
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+	};
+
 	struct SetBinding {
 		std::bitset<VUK_MAX_BINDINGS> used = {};
 		std::array<DescriptorBinding, VUK_MAX_BINDINGS> bindings;
 		DescriptorSetLayoutAllocInfo layout_info = {};
 
+		/// @brief Fill out a write of dst for every used binding, returns the number of writes
+		uint32_t fill_writes(std::span<VkWriteDescriptorSet, VUK_MAX_BINDINGS> writes, VkDescriptorSet dst) const;
+		/// @brief Pack the used bindings for layout_info.update_template, which must write exactly them
+		void fill_update_slots(std::span<DescriptorUpdateSlot, VUK_MAX_BINDINGS> slots) const;
+
 		bool operator==(const SetBinding& o) const {
 			if (layout_info != o.layout_info) return false;
 			for (size_t i = 0; i < VUK_MAX_BINDINGS; i++) {
@@ -454,6 +454,9 @@ namespace vuk {
 			binding_flags.set(set * 4 * VUK_MAX_BINDINGS + binding * 4 + 3, 1);
 			variable_count_max[set] = max_descriptors;
 		}
+		// set whose descriptors are pushed into the command buffer instead of allocated (VK_KHR_push_descriptor), at most one per pipeline
+		// ignored if the extension is not enabled. Sets used with bind_persistent can't be pushed
+		unsigned push_descriptor_set = (unsigned)-1;
 	};
 
 	/* filled out by the user */
@@ -485,7 +488,8 @@ namespace vuk {
 		static vuk::fixed_vector<vuk::DescriptorSetLayoutCreateInfo, VUK_MAX_SETS> build_descriptor_layouts(const Program&, const PipelineBaseCreateInfoBase&);
 		bool operator==(const PipelineBaseCreateInfo& o) const {
 			return shaders == o.shaders && rasterization_state == o.rasterization_state && color_blend_state == o.color_blend_state &&
-				color_blend_attachments == o.color_blend_attachments && depth_stencil_state == o.depth_stencil_state && binding_flags == o.binding_flags && variable_count_max == o.variable_count_max;
+				color_blend_attachments == o.color_blend_attachments && depth_stencil_state == o.depth_stencil_state && binding_flags == o.binding_flags && variable_count_max == o.variable_count_max &&
+				push_descriptor_set == o.push_descriptor_set;
 		}
 	};
 
@@ -530,7 +534,7 @@ namespace vuk {
 
 	public:
 		bool operator==(const ComputePipelineCreateInfo& o) const {
-			return shader == o.shader && binding_flags == o.binding_flags && variable_count_max == o.variable_count_max;
+			return shader == o.shader && binding_flags == o.binding_flags && variable_count_max == o.variable_count_max && push_descriptor_set == o.push_descriptor_set;
 		}
 	};
 }
@@ -632,6 +636,10 @@ namespace vuk {
 		vuk::fixed_vector<VkSpecializationInfo, 5> sis;
 		VkRenderPass render_pass;
 		uint32_t subpass;
+		// attachment formats, for pipelines used with dynamic rendering (render_pass is VK_NULL_HANDLE)
+		vuk::fixed_vector<VkFormat, VUK_MAX_COLOR_ATTACHMENTS> color_formats;
+		VkFormat depth_format = VK_FORMAT_UNDEFINED;
+		VkFormat stencil_format = VK_FORMAT_UNDEFINED;
 
 		VkGraphicsPipelineCreateInfo to_vk() const;
 		PipelineInstanceCreateInfo();
@@ -640,7 +648,8 @@ namespace vuk {
 			return base == o.base && binding_descriptions == o.binding_descriptions && attribute_descriptions == o.attribute_descriptions &&
 				color_blend_attachments == o.color_blend_attachments && color_blend_state == o.color_blend_state &&
 				vertex_input_state == o.vertex_input_state && multisample_state == o.multisample_state && dynamic_state == o.dynamic_state &&
-				render_pass == o.render_pass && subpass == o.subpass && smes == o.smes && sis == o.sis;
+				render_pass == o.render_pass && subpass == o.subpass && smes == o.smes && sis == o.sis &&
+				color_formats == o.color_formats && depth_format == o.depth_format && stencil_format == o.stencil_format;
 		}
 	};
 
@@ -648,6 +657,8 @@ namespace vuk {
 		VkPipeline pipeline;
 		VkPipelineLayout pipeline_layout;
 		std::array<DescriptorSetLayoutAllocInfo, VUK_MAX_SETS> layout_info;
+		// hash of the push constant ranges of pipeline_layout
+		size_t push_constant_hash;
 	};
 
 	template<> struct create_info<PipelineInfo> {
@@ -774,7 +785,7 @@ namespace std {
 	struct hash<vuk::PipelineInstanceCreateInfo> {
 		size_t operator()(vuk::PipelineInstanceCreateInfo const& x) const noexcept {
 			size_t h = 0;
-			hash_combine(h, x.base, reinterpret_cast<uint64_t>((VkRenderPass)x.render_pass), x.subpass);
+			hash_combine(h, x.base, reinterpret_cast<uint64_t>((VkRenderPass)x.render_pass), x.subpass, x.color_formats.size(), x.depth_format);
 			return h;
 		}
 	};
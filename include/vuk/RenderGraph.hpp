@@ -18,11 +18,13 @@ namespace vuk {
 	namespace detail {
 		struct BufferResource {
 			Name name;
+			unsigned hash_name;
 
 			Resource operator()(Access ba);
 		};
 		struct ImageResource {
 			Name name;
+			unsigned hash_name;
 
 			Resource operator()(Access ia);
 		};
@@ -37,11 +39,47 @@ namespace vuk {
 			vuk::PipelineStageFlags stages;
 			vuk::AccessFlags access;
 			vuk::ImageLayout layout; // ignored for buffers
+			// synchronization2 stages, when finer than stages (e.g. CLEAR instead of TRANSFER); 0 if the same
+			VkPipelineStageFlags2KHR stages2 = 0;
 		};
+		// mip levels and array layers of an image accessed by the pass, defaults to the whole image
+		struct Subrange {
+			uint32_t base_level = 0;
+			uint32_t level_count = VK_REMAINING_MIP_LEVELS;
+			uint32_t base_layer = 0;
+			uint32_t layer_count = VK_REMAINING_ARRAY_LAYERS;
+
+			bool operator==(const Subrange& o) const noexcept {
+				return base_level == o.base_level && level_count == o.level_count && base_layer == o.base_layer && layer_count == o.layer_count;
+			}
+		} subrange;
+
+		// dense id of the resource this name resolves to, assigned when the graph is compiled
+		uint32_t id = UINT32_MAX;
 
 		Resource(Name n, Type t, Access ia) : name(n), type(t), ia(ia) {
 			hash_name = hash::fnv1a::hash(name.data(), name.size(), hash::fnv1a::default_offset_basis);
 		}
+		// with the name already hashed, e.g. by the _image and _buffer literals
+		Resource(Name n, unsigned hash_name, Type t, Access ia) : name(n), hash_name(hash_name), type(t), ia(ia) {}
+
+		/// @brief Restrict an image use to the mip levels [base_level, base_level + level_count)
+		Resource mips(uint32_t base_level, uint32_t level_count = 1) const {
+			assert(type == Type::eImage);
+			Resource r = *this;
+			r.subrange.base_level = base_level;
+			r.subrange.level_count = level_count;
+			return r;
+		}
+
+		/// @brief Restrict an image use to the array layers [base_layer, base_layer + layer_count)
+		Resource layers(uint32_t base_layer, uint32_t layer_count = 1) const {
+			assert(type == Type::eImage);
+			Resource r = *this;
+			r.subrange.base_layer = base_layer;
+			r.subrange.layer_count = layer_count;
+			return r;
+		}
 
 		bool operator==(const Resource& o) const noexcept {
 			return hash_name == o.hash_name;
@@ -59,6 +97,9 @@ namespace vuk {
 		vuk::Format format;
 		vuk::Samples sample_count = vuk::Samples::e1;
 		Clear clear_value;
+		// mip level and array layer image_view starts at, when attached as a framebuffer attachment the view has a single level and layer
+		uint32_t base_level = 0;
+		uint32_t base_layer = 0;
 
 		static ImageAttachment from_texture(const vuk::Texture& t, Clear clear_value) {
 			return ImageAttachment{
@@ -75,6 +116,11 @@ namespace vuk {
 		Name executes_on;
 		float auxiliary_order = 0.f;
 		bool use_secondary_command_buffers = false;
+		/// @brief Mark the pass static: it is recorded once into a secondary command buffer kept by the Context, which is replayed until
+		/// this version, the renderpass or the resources bound to the pass change. Passes are identified by name. Framebuffer attachments may change freely,
+		/// and a recording is kept for each set of other resources the pass is seen with, so resources alternating between frames still replay
+		/// The recording must only reference memory that outlives it, so no scratch allocations. Static passes are only timed through their renderpass
+		std::optional<uint64_t> static_version;
 
 		std::vector<Resource> resources;
 		robin_hood::unordered_flat_map<Name, Name> resolves; // src -> dst
@@ -84,6 +130,9 @@ namespace vuk {
 
 	struct RenderGraph {
 		RenderGraph();
+		/// @brief Create a RenderGraph that allocates from an arena recycled through the Context
+		/// once warm, building and linking a graph of the same size allocates no new arena memory (see arena::heap_allocations and vuk::thread_heap_allocations)
+		RenderGraph(InflightContext&);
 		~RenderGraph();
 
 		RenderGraph(const RenderGraph&) = delete;
@@ -115,6 +164,13 @@ namespace vuk {
 		void attach_image(Name, ImageAttachment, Access initial, Access final);
 
 		void attach_managed(Name, Format, Dimension2D, Samples, Clear);
+		/// @brief Attach a buffer that is allocated by the rendergraph for every execution and has no contents before or after it
+		/// Managed buffers whose uses don't overlap share memory
+		void attach_managed_buffer(Name, size_t size, BufferUsageFlags usage);
+		/// @brief Attach an image that persists across frames, e.g. for temporal effects
+		/// The Context owns n_versions copies and rotates them every frame: `name` is the copy of this frame, `name_1` the copy of the previous frame, up to `name_<n_versions - 1>`
+		/// Copies are left in their last use, and the next frame waits on exactly that use. Copies are recreated (with undefined contents) if the description changes
+		void attach_history(Name, ImageCreateInfo, uint32_t n_versions = 2);
 
 		/// @brief Consume this RenderGraph and create an ExecutableRenderGraph
 		struct ExecutableRenderGraph link(PerThreadContext& ptc)&&;
@@ -127,6 +183,8 @@ namespace vuk {
 
 		MapProxy<Name, std::span<const struct UseRef>> get_use_chains();
 		MapProxy<Name, const struct AttachmentRPInfo&> get_bound_attachments();
+		/// @brief Names of the passes removed because none of their outputs reach an external image, a swapchain or a buffer with a final use
+		std::span<const Name> get_culled_passes();
 		static vuk::ImageUsageFlags compute_usage(std::span<const UseRef> chain);
 	private:
 		struct RGImpl* impl;
@@ -150,25 +208,65 @@ namespace vuk {
 		ExecutableRenderGraph(ExecutableRenderGraph&&) noexcept;
 		ExecutableRenderGraph& operator=(ExecutableRenderGraph&&) noexcept;
 
+		/// @brief Record the graph into a command buffer for the graphics queue
+		/// If the context has an async compute queue, compute-only passes are recorded into separate command buffers which are submitted here,
+		/// together with the graphics work preceding them; the returned command buffer must be submitted to the graphics queue after this returns
 		VkCommandBuffer execute(vuk::PerThreadContext&, std::vector<std::pair<Swapchain*, size_t>> swp_with_index);
 
+		/// @brief Runs job(ptc, i) for every i in [0, count), possibly concurrently, and returns once all of them have finished.
+		/// Each job must be given a PerThreadContext that no other thread uses at the same time (e.g. one per worker thread), created from the same InflightContext
+		using ParallelFor = std::function<void(size_t count, const std::function<void(PerThreadContext&, size_t)>& job)>;
+		/// @brief Execute the graph, recording every pass into a secondary command buffer through parallel_for
+		/// The returned primary command buffer executes the secondaries in order, with the barriers and renderpasses between them
+		/// Passes with use_secondary_command_buffers execute their own secondaries, they are run on the calling thread while the primary is recorded
+		VkCommandBuffer execute(vuk::PerThreadContext&, std::vector<std::pair<Swapchain*, size_t>> swp_with_index, const ParallelFor& parallel_for);
+
+		/// @brief Write GPU timestamps around every pass, renderpass and barrier batch of the following executions
+		/// Optionally query pipeline statistics for every pass on the graphics queue. Results are read back without stalling once the frame is recycled, see Context::get_gpu_timings
+		/// Passes executing their own secondary command buffers are only timed through their renderpass
+		void enable_profiling(VkQueryPipelineStatisticFlags pipeline_statistics = 0);
+
+		/// @brief Submits a finished command buffer to the queue of the domain
+		using Submit = std::function<void(Domain, const VkSubmitInfo&)>;
+		/// @brief Cut the recording of the following executions every `renderpasses` renderpasses, so that the GPU starts on early passes while later ones are recorded
+		/// If a renderpass in the second half of a chunk starts with barriers, the chunk is cut before the latest such renderpass instead, where the GPU waits anyway
+		/// Every command buffer but the one returned by execute is handed to submit as soon as it is recorded (by default, submitted to the Context's queues)
+		/// Command buffers of the same queue are ordered by submission, only the ones crossing queues are connected with semaphores
+		void split_submissions(size_t renderpasses, Submit submit = {});
+		/// @brief Wait on semaphore (e.g. signalled by vkAcquireNextImageKHR) at stages before the first use of a swapchain image
+		/// The wait is submitted by execute, with the first command buffer using a swapchain image, so the returned command buffer must not wait on it again
+		/// Needed whenever execute submits command buffers itself (split submissions or async compute), as those might otherwise use the image before it is acquired
+		void wait_for_swapchain(VkSemaphore semaphore, vuk::PipelineStageFlags stages);
+
 		struct BufferInfo get_resource_buffer(Name);
 		struct AttachmentRPInfo get_resource_image(Name);
+		/// @brief View of the subrange of an image, for subranges used by some pass of the graph
+		vuk::ImageView get_resource_image_view(Name, const Resource::Subrange&);
 
 		bool is_resource_image_in_general_layout(Name n, struct PassInfo* pass_info);
 	private:
 		struct RGImpl* impl;
 
-		void create_attachment(PerThreadContext& ptc, Name name, struct AttachmentRPInfo& attachment_info, Extent2D fb_extent, SampleCountFlagBits samples);
+		struct RGCI describe_attachment(uint32_t id, struct AttachmentRPInfo& attachment_info, Extent2D fb_extent, SampleCountFlagBits samples);
+		void create_transients(PerThreadContext& ptc, std::span<std::pair<uint32_t, struct RGCI>> transients);
+		void create_transient_buffers(PerThreadContext& ptc);
 		void fill_renderpass_info(struct RenderPassInfo& rpass, const size_t& i, class CommandBuffer& cobuf);
+		/// @brief Begin a secondary command buffer continuing subpass sp of rpass, if it has one
+		void begin_secondary(VkCommandBuffer scbuf, struct RenderPassInfo& rpass, size_t sp, class CommandBuffer& cobuf, VkCommandBufferUsageFlags flags, VkFramebuffer framebuffer);
+		/// @brief Secondary command buffer of a static pass, recorded if the Context has none for its current version, renderpass and resources
+		VkCommandBuffer acquire_static_pass(PerThreadContext& ptc, struct RenderPassInfo& rpass, size_t sp, struct PassInfo& pass);
+		void bind_resources(PerThreadContext& ptc, const std::vector<std::pair<Swapchain*, size_t>>& swp_with_index);
+		void record_renderpasses(PerThreadContext& ptc, VkCommandBuffer cbuf, size_t rp_begin, size_t rp_end);
+		/// @brief Record every queue batch with record, in chunks of renderpasses if submissions are split, submit all but the last chunk and return the last one
+		VkCommandBuffer submit_batches(PerThreadContext& ptc, const std::function<void(VkCommandBuffer, size_t rp_begin, size_t rp_end)>& record);
 	};
 }
 
-inline vuk::detail::ImageResource operator "" _image(const char* name, size_t) {
-	return { name };
+inline constexpr vuk::detail::ImageResource operator "" _image(const char* name, size_t len) {
+	return { vuk::Name(name, len), hash::fnv1a::hash(name, len, hash::fnv1a::default_offset_basis) };
 }
 
-inline vuk::detail::BufferResource operator "" _buffer(const char* name, size_t) {
-	return { name };
+inline constexpr vuk::detail::BufferResource operator "" _buffer(const char* name, size_t len) {
+	return { vuk::Name(name, len), hash::fnv1a::hash(name, len, hash::fnv1a::default_offset_basis) };
 }
 
@@ -1,81 +1,126 @@
 #pragma once
 //http://howardhinnant.github.io/stack_alloc.html
 //https://codereview.stackexchange.com/a/31575
-// but modified to use a heap arena
+// but modified to use a growable heap arena
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <new>
+#include <vector>
 
+// monotonic arena made of a chain of chunks
+// when a chunk is exhausted the next one is used, or a new one twice as large is chained on
+// reset() rewinds to the first chunk and keeps all of them, so an arena that is reused for the same work stops allocating
 class arena {
 	static const std::size_t alignment = 16;
-	std::size_t size_;
-	char* buf_;
+
+	struct chunk {
+		char* buf;
+		std::size_t size;
+	};
+	std::vector<chunk> chunks_;
+	std::size_t current_ = 0;
 	char* ptr_;
 
 	std::size_t align_up(std::size_t n) noexcept {
 		return (n + (alignment - 1)) & ~(alignment - 1);
 	}
 
-	bool pointer_in_buffer(char* p) noexcept {
-		return buf_ <= p && p <= buf_ + size_;
+	bool pointer_in_chunk(const chunk& c, char* p) noexcept {
+		return c.buf <= p && p <= c.buf + c.size;
+	}
+
+	void add_chunk(std::size_t n) {
+		chunks_.push_back({ (char*) operator new[](n, (std::align_val_t{ alignment })), n });
+		heap_allocations++;
+	}
+
+	void free_chunks() noexcept {
+		for (auto& c : chunks_) {
+			::operator delete[](c.buf, std::align_val_t{ alignment });
+		}
+		chunks_.clear();
 	}
 
 public:
-	arena(std::size_t N) noexcept {
-		buf_ = (char*) operator new[](N, (std::align_val_t{ alignment }));
-		ptr_ = buf_;
-		size_ = N;
+	/// @brief Number of chunks allocated from the heap by all arenas, a reused arena in steady state does not add to it
+	static inline std::atomic<std::size_t> heap_allocations = 0;
+
+	arena(std::size_t N) {
+		add_chunk(N);
+		ptr_ = chunks_[0].buf;
 	}
 	~arena() {
-		::operator delete[](buf_, std::align_val_t{ alignment });
+		free_chunks();
 		ptr_ = nullptr;
 	}
+	// copies get a single chunk as large as the whole source arena
 	arena(const arena& o) {
-		size_ = o.size_;
-		buf_ = (char*) operator new[](size_, (std::align_val_t{ alignment }));
-		ptr_ = buf_;
+		add_chunk(o.size());
+		ptr_ = chunks_[0].buf;
 	}
 	arena& operator=(const arena& o) {
-		::operator delete[](buf_, std::align_val_t{ alignment });
-		size_ = o.size_;
-		buf_ = (char*) operator new[](size_, (std::align_val_t{ alignment }));
-		ptr_ = buf_;
+		auto n = o.size();
+		free_chunks();
+		add_chunk(n);
+		current_ = 0;
+		ptr_ = chunks_[0].buf;
 		return *this;
 	};
 
 	char* allocate(std::size_t n);
 	void deallocate(char* p, std::size_t n) noexcept;
 
-	std::size_t size() {
-		return size_;
+	std::size_t size() const {
+		std::size_t s = 0;
+		for (auto& c : chunks_) {
+			s += c.size;
+		}
+		return s;
 	}
 	std::size_t used() const {
-		return static_cast<std::size_t>(ptr_ - buf_);
+		std::size_t u = 0;
+		for (std::size_t i = 0; i < current_; i++) {
+			u += chunks_[i].size;
+		}
+		return u + static_cast<std::size_t>(ptr_ - chunks_[current_].buf);
 	}
 	void reset() {
-		ptr_ = buf_;
+		current_ = 0;
+		ptr_ = chunks_[0].buf;
 	}
 };
 
 inline char* arena::allocate(std::size_t n) {
-	assert(pointer_in_buffer(ptr_) && "short_alloc has outlived arena");
+	assert(ptr_ && pointer_in_chunk(chunks_[current_], ptr_) && "short_alloc has outlived arena");
 	n = align_up(n);
-	if (buf_ + size_ - ptr_ >= (int64_t)n) {
-		char* r = ptr_;
-		ptr_ += n;
-		return r;
+	while (chunks_[current_].buf + chunks_[current_].size - ptr_ < (int64_t)n) {
+		// the rest of the current chunk is wasted until the next reset
+		if (current_ + 1 == chunks_.size()) {
+			add_chunk(std::max(n, chunks_[current_].size * 2));
+		}
+		current_++;
+		ptr_ = chunks_[current_].buf;
 	}
-	return static_cast<char*>(::operator new(n));
+	char* r = ptr_;
+	ptr_ += n;
+	return r;
 }
 
+// only the last allocation is given back, the rest is reclaimed by reset()
 inline void arena::deallocate(char* p, std::size_t n) noexcept {
-	assert(pointer_in_buffer(ptr_) && "short_alloc has outlived arena");
-	if (pointer_in_buffer(p)) {
-		n = align_up(n);
-		if (p + n == ptr_)
-			ptr_ = p;
-	} else
-		::operator delete(p);
+	assert(ptr_ && pointer_in_chunk(chunks_[current_], ptr_) && "short_alloc has outlived arena");
+	n = align_up(n);
+	if (pointer_in_chunk(chunks_[current_], p) && p + n == ptr_)
+		ptr_ = p;
+}
+
+namespace vuk {
+	/// @brief Number of heap allocations (global operator new) made by the calling thread
+	/// only counted when vuk is built with VUK_COUNT_HEAP_ALLOCATIONS, which replaces the global operator new of the program; 0 otherwise
+	std::size_t thread_heap_allocations() noexcept;
 }
 
 template<class T, std::size_t N>
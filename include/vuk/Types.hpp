@@ -607,6 +607,8 @@ namespace vuk {
 	Extent3D format_to_texel_block_extent(vuk::Format) noexcept;
 	// compute the byte size of an image with given format and extent
 	uint32_t compute_image_size(vuk::Format, vuk::Extent3D) noexcept;
+	// true for the UINT and SINT color formats, which can't be averaged
+	bool format_is_integer(vuk::Format) noexcept;
 
 	enum class IndexType {
 		eUint16 = VK_INDEX_TYPE_UINT16,
@@ -939,6 +941,9 @@ namespace vuk {
 		eMemoryRW
 	};
 
+	// the queue work is submitted to
+	enum class Domain { eGraphics, eCompute };
+
 	// Aligns given value up to nearest multiply of align value. For example: VmaAlignUp(11, 8) = 16.
 	// Use types like uint32_t, uint64_t as T.
 	// Source: VMA
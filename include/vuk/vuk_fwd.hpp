@@ -19,6 +19,10 @@ namespace vuk {
 	// temporary
 	struct RGImage;
 	struct RGCI;
+	struct TransientHeap;
+	struct TransientHeapCreateInfo;
+	struct TransientBuffers;
+	struct TransientBuffersCreateInfo;
 
 	// 0b00111 -> 3
 	inline uint32_t num_leading_ones(uint32_t mask) {
@@ -1,6 +1,7 @@
 #include "Allocator.hpp"
 #include <string>
 #include <numeric>
+#include <algorithm>
 
 namespace vuk {
 	PFN_vmaAllocateDeviceMemoryFunction Allocator::real_alloc_callback = nullptr;
@@ -407,6 +408,70 @@ namespace vuk {
 		vmaDestroyImage(allocator, image, images.at(reinterpret_cast<uint64_t>(vkimg)));
 		images.erase(reinterpret_cast<uint64_t>(vkimg));
 	}
+
+	VmaAllocation Allocator::allocate_image_memory(VkMemoryRequirements mem_reqs, bool lazily_allocated) {
+		std::lock_guard _(mutex);
+		VmaAllocationCreateInfo db{};
+		db.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		db.usage = lazily_allocated ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
+		db.requiredFlags = 0;
+		db.preferredFlags = 0;
+		db.pool = nullptr;
+		VmaAllocation vout;
+		auto result = vmaAllocateMemory(allocator, &mem_reqs, &db, &vout, nullptr);
+		// most desktop parts have no lazily allocated memory
+		if (result != VK_SUCCESS && lazily_allocated) {
+			db.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+			result = vmaAllocateMemory(allocator, &mem_reqs, &db, &vout, nullptr);
+		}
+		assert(result == VK_SUCCESS);
+		return vout;
+	}
+
+	void Allocator::bind_image_memory(VkImage image, VmaAllocation memory, VkDeviceSize offset) {
+		std::lock_guard _(mutex);
+		VmaAllocationInfo vai;
+		vmaGetAllocationInfo(allocator, memory, &vai);
+		vkBindImageMemory(device, image, vai.deviceMemory, vai.offset + offset);
+	}
+
+	void Allocator::free_image_memory(VmaAllocation memory) {
+		std::lock_guard _(mutex);
+		vmaFreeMemory(allocator, memory);
+	}
+
+	VkDeviceSize place_aliased(std::span<const VkMemoryRequirements> reqs, std::span<const std::pair<uint32_t, uint32_t>> lifetimes, std::span<VkDeviceSize> offsets) {
+		// place the largest allocations first, smaller ones fill the gaps
+		std::vector<size_t> order(reqs.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return reqs[a].size > reqs[b].size; });
+
+		VkDeviceSize block_size = 0;
+		std::vector<size_t> placed;
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> taken;
+		for (auto i : order) {
+			// memory ranges of placed allocations that are alive at the same time
+			taken.clear();
+			for (auto j : placed) {
+				if (lifetimes[j].first <= lifetimes[i].second && lifetimes[i].first <= lifetimes[j].second) {
+					taken.emplace_back(offsets[j], offsets[j] + reqs[j].size);
+				}
+			}
+			std::sort(taken.begin(), taken.end());
+			// first fit
+			VkDeviceSize offset = 0;
+			for (auto& [begin, end] : taken) {
+				if (align_up(offset, reqs[i].alignment) + reqs[i].size <= begin)
+					break;
+				offset = std::max(offset, end);
+			}
+			offsets[i] = align_up(offset, reqs[i].alignment);
+			block_size = std::max(block_size, offsets[i] + reqs[i].size);
+			placed.push_back(i);
+		}
+		return block_size;
+	}
+
 	Allocator::~Allocator() {
 		for (auto& [ps, p] : pools) {
 			destroy(p);
@@ -142,6 +142,12 @@ namespace vuk {
 		vuk::Image create_image(vuk::ImageCreateInfo ici);
 		void destroy_image(vuk::Image image);
 
+		// allocate a block of device memory that images are bound into manually (used for aliasing)
+		// lazily allocated memory is used if requested and available, otherwise the block is regular device memory
+		VmaAllocation allocate_image_memory(VkMemoryRequirements mem_reqs, bool lazily_allocated = false);
+		void bind_image_memory(VkImage image, VmaAllocation memory, VkDeviceSize offset);
+		void free_image_memory(VmaAllocation memory);
+
 	private:
 		// not locked, must be called from a locked fn
 		VmaPool _create_pool(MemoryUsage mem_usage, vuk::BufferUsageFlags buffer_usage);
@@ -151,6 +157,10 @@ namespace vuk {
 		VkMemoryRequirements get_memory_requirements(VkBufferCreateInfo& bci);
 	};
 
+	// place allocations into a single block, so that allocations with overlapping [first, last] lifetimes don't overlap in memory
+	// writes the offset of each allocation and returns the size of the block
+	VkDeviceSize place_aliased(std::span<const VkMemoryRequirements> reqs, std::span<const std::pair<uint32_t, uint32_t>> lifetimes, std::span<VkDeviceSize> offsets);
+
 	template<> struct create_info<PoolAllocator> {
 		using type = PoolSelect;
 	};
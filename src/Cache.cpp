@@ -132,6 +132,7 @@ namespace vuk {
 	template class Cache<vuk::DescriptorSetLayoutAllocInfo>;
 	template class Cache<vuk::ShaderModule>;
 	template class Cache<vuk::RGImage>;
+	template class Cache<vuk::TransientHeap>;
 
 	template<class T, size_t FC>
 	PerFrameCache<T, FC>::~PerFrameCache() {
@@ -197,6 +198,7 @@ namespace vuk {
 
 	template class PerFrameCache<vuk::DescriptorSet, Context::FC>;
 	template class PerFrameCache<LinearAllocator, Context::FC>;
+	template class PerFrameCache<vuk::TransientBuffers, Context::FC>;
 
 	template class Cache<vuk::DescriptorPool>;
 
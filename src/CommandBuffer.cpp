@@ -37,6 +37,11 @@ namespace vuk {
 		return rg->get_resource_image(n).iv;
 	}
 
+	vuk::ImageView CommandBuffer::get_resource_image_view(Name n, uint32_t base_level, uint32_t level_count, uint32_t base_layer, uint32_t layer_count) const {
+		assert(rg);
+		return rg->get_resource_image_view(n, Resource::Subrange{ base_level, level_count, base_layer, layer_count });
+	}
+
 	CommandBuffer& CommandBuffer::set_viewport(unsigned index, vuk::Viewport vp) {
 		vkCmdSetViewport(command_buffer, 0, 1, (VkViewport*)&vp);
 		return *this;
@@ -257,7 +262,22 @@ namespace vuk {
 		return bind_storage_image(set, binding, get_resource_image_view(name));
 	}
 
+	CommandBuffer& CommandBuffer::bind_input_attachment(unsigned set, unsigned binding, vuk::ImageView image_view, vuk::ImageLayout il) {
+		sets_used[set] = true;
+		set_bindings[set].bindings[binding].type = vuk::DescriptorType::eInputAttachment;
+		set_bindings[set].bindings[binding].image = vuk::DescriptorImageInfo({}, image_view, il);
+		set_bindings[set].used.set(binding);
+		return *this;
+	}
+
+	CommandBuffer& CommandBuffer::bind_input_attachment(unsigned set, unsigned binding, Name name) {
+		assert(rg);
+		auto layout = rg->is_resource_image_in_general_layout(name, current_pass) ? vuk::ImageLayout::eGeneral : vuk::ImageLayout::eShaderReadOnlyOptimal;
+		return bind_input_attachment(set, binding, get_resource_image_view(name), layout);
+	}
+
 	void* CommandBuffer::_map_scratch_uniform_binding(unsigned set, unsigned binding, size_t size) {
+		assert(!static_descriptor_sets && "scratch memory is recycled, static passes can't use it");
 		auto buf = ptc._allocate_scratch_buffer(vuk::MemoryUsage::eCPUtoGPU, vuk::BufferUsageFlagBits::eUniformBuffer, size, 1, true);
 		bind_uniform_buffer(set, binding, buf);
 		return buf.mapped_ptr;
@@ -277,6 +297,7 @@ namespace vuk {
 	}
 
 	CommandBuffer& CommandBuffer::draw_indexed_indirect(std::span<vuk::DrawIndexedIndirectCommand> cmds) {
+		assert(!static_descriptor_sets && "scratch memory is recycled, static passes can't use it");
 		_bind_graphics_pipeline_state();
 		auto buf = ptc._allocate_scratch_buffer(vuk::MemoryUsage::eCPUtoGPU, vuk::BufferUsageFlagBits::eIndirectBuffer, cmds.size_bytes(), 1, true);
 		memcpy(buf.mapped_ptr, cmds.data(), cmds.size_bytes());
@@ -311,6 +332,15 @@ namespace vuk {
 		cbii.renderPass = ongoing_renderpass->renderpass;
 		cbii.subpass = ongoing_renderpass->subpass;
 		cbii.framebuffer = VK_NULL_HANDLE; //TODO
+		VkCommandBufferInheritanceRenderingInfoKHR cbiri{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+		if (ongoing_renderpass->renderpass == VK_NULL_HANDLE) {
+			cbiri.colorAttachmentCount = (uint32_t)ongoing_renderpass->color_formats.size();
+			cbiri.pColorAttachmentFormats = ongoing_renderpass->color_formats.data();
+			cbiri.depthAttachmentFormat = ongoing_renderpass->depth_format;
+			cbiri.stencilAttachmentFormat = ongoing_renderpass->stencil_format;
+			cbiri.rasterizationSamples = (VkSampleCountFlagBits)ongoing_renderpass->samples;
+			cbii.pNext = &cbiri;
+		}
 		cbi.pInheritanceInfo = &cbii;
 		vkBeginCommandBuffer(scbuf, &cbi);
 		return SecondaryCommandBuffer(rg, *nptc, scbuf, ongoing_renderpass);
@@ -319,6 +349,7 @@ namespace vuk {
 	void CommandBuffer::execute(std::span<VkCommandBuffer> scbufs) {
 		if (scbufs.size() > 0) {
 			vkCmdExecuteCommands(command_buffer, (uint32_t)scbufs.size(), scbufs.data());
+			_invalidate_bound_state();
 		}
 	}
 
@@ -411,12 +442,83 @@ namespace vuk {
 		}
 		imb.subresourceRange = isr;
 		vkCmdPipelineBarrier(command_buffer, (VkPipelineStageFlags)src_use.stages, (VkPipelineStageFlags)dst_use.stages, {}, 0, nullptr, 0, nullptr, 1, &imb);
+		ptc.ifc.pipeline_barrier_calls++;
+	}
+
+	// hash of the active descriptors of a set, together with the layout it is allocated for
+	static size_t hash_set_binding(const SetBinding& sb) {
+		size_t h = 0;
+		hash_combine(h, sb.layout_info.layout);
+		for (unsigned j = 0; j < VUK_MAX_BINDINGS; j++) {
+			if (!sb.used[j])
+				continue;
+			auto type = sb.bindings[j].type;
+			if (type == vuk::DescriptorType::eUniformBuffer || type == vuk::DescriptorType::eUniformBufferDynamic || type == vuk::DescriptorType::eStorageBuffer) {
+				VkDescriptorBufferInfo dbi = sb.bindings[j].buffer;
+				hash_combine(h, j, type, dbi.buffer, dbi.offset, dbi.range);
+			} else {
+				VkDescriptorImageInfo dii = sb.bindings[j].image.dii;
+				hash_combine(h, j, type, dii.sampler, dii.imageView, dii.imageLayout);
+			}
+		}
+		return h;
+	}
+
+	void CommandBuffer::_invalidate_bound_state() {
+		bound = {};
+		current_pipeline_key = 0;
+		current_pipeline_inputs = {};
+		pushed_ranges.clear();
+		pushed_constants = {};
+		pushed_layout_hash = 0;
+	}
+
+	void CommandBuffer::_switch_layout(BoundState& state, VkPipelineLayout layout, const std::array<DescriptorSetLayoutAllocInfo, VUK_MAX_SETS>& layout_info, size_t push_constant_hash) {
+		if (state.layout == layout) {
+			return;
+		}
+		// a bound set stays valid if the new layout has the same push constant ranges and the same set layouts up to and including its own
+		bool compatible = state.layout != VK_NULL_HANDLE && state.push_constant_hash == push_constant_hash;
+		for (unsigned i = 0; i < VUK_MAX_SETS; i++) {
+			compatible = compatible && state.set_layouts[i] == layout_info[i].layout;
+			if (!compatible) {
+				state.sets_valid[i] = false;
+			}
+			state.set_layouts[i] = layout_info[i].layout;
+		}
+		state.layout = layout;
+		state.push_constant_hash = push_constant_hash;
 	}
 
 	void CommandBuffer::_bind_state(bool graphics) {
+		auto& state = bound[graphics ? 0 : 1];
+		auto bind_point = graphics ? VK_PIPELINE_BIND_POINT_GRAPHICS : VK_PIPELINE_BIND_POINT_COMPUTE;
+		vuk::PipelineInfo& pipeline = graphics ? *current_pipeline : *current_compute_pipeline;
+
+		// pushed values survive across layouts with the same push constant ranges
+		if (pushed_layout_hash != state.push_constant_hash) {
+			pushed_ranges.clear();
+			pushed_layout_hash = state.push_constant_hash;
+		}
 		for (auto& pcr : pcrs) {
 			void* data = push_constant_buffer.data() + pcr.offset;
-			vkCmdPushConstants(command_buffer, current_pipeline->pipeline_layout, pcr.stageFlags, pcr.offset, pcr.size, data);
+			void* pushed = pushed_constants.data() + pcr.offset;
+			auto it = std::find_if(pushed_ranges.begin(), pushed_ranges.end(), [&](auto& r) { return r.stageFlags == pcr.stageFlags && r.offset == pcr.offset && r.size == pcr.size; });
+			if (it != pushed_ranges.end() && memcmp(data, pushed, pcr.size) == 0) {
+				bind_stats.skipped++;
+				continue;
+			}
+			vkCmdPushConstants(command_buffer, state.layout, pcr.stageFlags, pcr.offset, pcr.size, data);
+			bind_stats.issued++;
+			::memcpy(pushed, data, pcr.size);
+			// overlapping ranges of other stages no longer match the shadow copy
+			pushed_ranges.resize(std::distance(pushed_ranges.begin(), std::remove_if(pushed_ranges.begin(), pushed_ranges.end(), [&](auto& r) {
+				return r.offset < pcr.offset + pcr.size && pcr.offset < r.offset + r.size;
+			})));
+			if (pushed_ranges.size() == VUK_MAX_PUSHCONSTANT_RANGES) {
+				pushed_ranges.clear();
+			}
+			pushed_ranges.push_back(pcr);
 		}
 		pcrs.clear();
 
@@ -424,14 +526,74 @@ namespace vuk {
 			bool persistent = persistent_sets_used[i];
 			if (!sets_used[i] && !persistent_sets_used[i])
 				continue;
-			set_bindings[i].layout_info = graphics ? current_pipeline->layout_info[i] : current_compute_pipeline->layout_info[i];
+			auto& sb = set_bindings[i];
+			sb.layout_info = pipeline.layout_info[i];
+			// dynamic uniform buffers are written at offset 0 and get their offset when the set is bound, so the set only depends on the buffer
+			std::array<uint32_t, VUK_MAX_BINDINGS> offsets;
+			uint32_t offset_count = 0;
+			for (unsigned j = 0; j < VUK_MAX_BINDINGS; j++) {
+				if (!(sb.layout_info.dynamic_mask & (1u << j)))
+					continue;
+				auto& binding = sb.bindings[j];
+				if (!persistent && sb.used[j] && binding.type == vuk::DescriptorType::eUniformBuffer) {
+					dynamic_offsets[i][j] = (uint32_t)binding.buffer.offset;
+					binding.buffer.offset = 0;
+					binding.type = vuk::DescriptorType::eUniformBufferDynamic;
+				}
+				offsets[offset_count] = persistent ? 0 : dynamic_offsets[i][j];
+				offset_count++;
+			}
+			bool same_offsets = state.offset_counts[i] == offset_count && std::equal(offsets.begin(), offsets.begin() + offset_count, state.offsets[i].begin());
+			auto bound_with = [&](VkDescriptorSet ds, size_t set_hash) {
+				state.sets_valid[i] = true;
+				state.sets[i] = ds;
+				state.persistent[i] = persistent;
+				state.set_hashes[i] = set_hash;
+				if (!persistent) {
+					state.set_bindings[i] = sb;
+				}
+				state.offsets[i] = offsets;
+				state.offset_counts[i] = offset_count;
+			};
+
+			VkDescriptorSet ds;
+			size_t set_hash = 0;
 			if (!persistent) {
-				auto ds = ptc.acquire_descriptorset(set_bindings[i]);
-				vkCmdBindDescriptorSets(command_buffer, graphics ? VK_PIPELINE_BIND_POINT_GRAPHICS : VK_PIPELINE_BIND_POINT_COMPUTE, graphics ? current_pipeline->pipeline_layout : current_compute_pipeline->pipeline_layout, i, 1, &ds.descriptor_set, 0, nullptr);
+				set_hash = hash_set_binding(sb);
+				auto& bound_sb = state.set_bindings[i];
+				bool same_set = state.sets_valid[i] && !state.persistent[i] && state.set_hashes[i] == set_hash && bound_sb.used == sb.used && bound_sb == sb;
+				if (same_set && same_offsets) {
+					bind_stats.skipped++;
+					sb.used.reset();
+					continue;
+				}
+				if (same_set) {
+					// only the dynamic offsets changed: rebind the bound set
+					ds = state.sets[i];
+				} else if (sb.layout_info.push_descriptor) {
+					std::array<VkWriteDescriptorSet, VUK_MAX_BINDINGS> writes;
+					auto count = sb.fill_writes(writes, VK_NULL_HANDLE);
+					ptc.ctx.cmdPushDescriptorSetKHR(command_buffer, bind_point, state.layout, i, count, writes.data());
+					bind_stats.issued++;
+					bound_with(VK_NULL_HANDLE, set_hash);
+					sb.used.reset();
+					continue;
+				} else {
+					ds = (static_descriptor_sets ? static_descriptor_sets->emplace_back(ptc.create(sb)) : ptc.acquire_descriptorset(sb)).descriptor_set;
+				}
 			} else {
-				vkCmdBindDescriptorSets(command_buffer, graphics ? VK_PIPELINE_BIND_POINT_GRAPHICS : VK_PIPELINE_BIND_POINT_COMPUTE, graphics ? current_pipeline->pipeline_layout : current_compute_pipeline->pipeline_layout, i, 1, &persistent_sets[i], 0, nullptr);
+				assert(!sb.layout_info.push_descriptor && "persistent sets can't be bound to a push descriptor set");
+				ds = persistent_sets[i];
+				if (state.sets_valid[i] && state.persistent[i] && state.sets[i] == ds && same_offsets) {
+					bind_stats.skipped++;
+					continue;
+				}
 			}
-			set_bindings[i].used.reset();
+			vkCmdBindDescriptorSets(command_buffer, bind_point, state.layout, i, 1, &ds, offset_count, offsets.data());
+			bind_stats.issued++;
+			// binding a set disturbs the higher ones if they were bound with an incompatible layout, which _switch_layout already accounts for
+			bound_with(ds, set_hash);
+			sb.used.reset();
 		}
 		sets_used.reset();
 		persistent_sets_used.reset();
@@ -439,7 +601,15 @@ namespace vuk {
 
 	void CommandBuffer::_bind_compute_pipeline_state() {
 		if (next_compute_pipeline) {
-			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, next_compute_pipeline->pipeline);
+			auto& state = bound[1];
+			if (state.pipeline != next_compute_pipeline->pipeline) {
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, next_compute_pipeline->pipeline);
+				bind_stats.issued++;
+				state.pipeline = next_compute_pipeline->pipeline;
+				_switch_layout(state, next_compute_pipeline->pipeline_layout, next_compute_pipeline->layout_info, next_compute_pipeline->push_constant_hash);
+			} else {
+				bind_stats.skipped++;
+			}
 			current_compute_pipeline = *next_compute_pipeline;
 			next_compute_pipeline = nullptr;
 		}
@@ -447,8 +617,64 @@ namespace vuk {
 		_bind_state(false);
 	}
 
+	// hash of everything a graphics pipeline instance is created from
+	size_t CommandBuffer::_pipeline_key() const {
+		size_t h = 0;
+		hash_combine(h, next_pipeline, topology, ongoing_renderpass->renderpass, ongoing_renderpass->subpass, ongoing_renderpass->samples, ongoing_renderpass->color_attachments.size());
+		hash_combine(h, ongoing_renderpass->depth_format, ongoing_renderpass->stencil_format);
+		for (auto& f : ongoing_renderpass->color_formats) {
+			hash_combine(h, f);
+		}
+		for (auto& ad : attribute_descriptions) {
+			hash_combine(h, ad.location, ad.binding, ad.format, ad.offset);
+		}
+		for (auto& bd : binding_descriptions) {
+			hash_combine(h, bd.binding, bd.stride, bd.inputRate);
+		}
+		for (auto& [sme, stage] : smes) {
+			hash_combine(h, sme.constantID, sme.offset, sme.size, stage);
+			hash_combine(h, ::hash::fnv1a::hash((const char*)specialization_constant_buffer.data() + sme.offset, sme.size, ::hash::fnv1a::default_offset_basis));
+		}
+		return h;
+	}
+
+	CommandBuffer::PipelineInputs CommandBuffer::_pipeline_inputs() const {
+		PipelineInputs inputs;
+		inputs.base = next_pipeline;
+		inputs.topology = topology;
+		inputs.renderpass = ongoing_renderpass->renderpass;
+		inputs.subpass = ongoing_renderpass->subpass;
+		inputs.samples = ongoing_renderpass->samples;
+		inputs.color_attachment_count = ongoing_renderpass->color_attachments.size();
+		inputs.color_formats = ongoing_renderpass->color_formats;
+		inputs.depth_format = ongoing_renderpass->depth_format;
+		inputs.stencil_format = ongoing_renderpass->stencil_format;
+		inputs.attribute_descriptions = attribute_descriptions;
+		inputs.binding_descriptions = binding_descriptions;
+		inputs.smes = smes;
+		// only the bytes the specialization constants read
+		for (auto& [sme, stage] : smes) {
+			::memcpy(inputs.specialization_constants.data() + sme.offset, specialization_constant_buffer.data() + sme.offset, sme.size);
+		}
+		return inputs;
+	}
+
 	void CommandBuffer::_bind_graphics_pipeline_state() {
 		if (next_pipeline) {
+			// same pipeline instance as the one bound: skip building it and looking it up
+			auto key = _pipeline_key();
+			if (current_pipeline && key == current_pipeline_key && _pipeline_inputs() == current_pipeline_inputs) {
+				// vertex input is consumed by the pipeline, as when building it
+				attribute_descriptions.clear();
+				binding_descriptions.clear();
+				next_pipeline = nullptr;
+				bind_stats.skipped++;
+				_bind_state(true);
+				return;
+			}
+			current_pipeline_key = key;
+			current_pipeline_inputs = _pipeline_inputs();
+
 			vuk::PipelineInstanceCreateInfo pi;
 			pi.base = next_pipeline;
 
@@ -491,6 +717,9 @@ namespace vuk {
 
 			pi.render_pass = ongoing_renderpass->renderpass;
 			pi.subpass = ongoing_renderpass->subpass;
+			pi.color_formats = ongoing_renderpass->color_formats;
+			pi.depth_format = ongoing_renderpass->depth_format;
+			pi.stencil_format = ongoing_renderpass->stencil_format;
 
 			pi.dynamic_state.pDynamicStates = next_pipeline->dynamic_states.data();
 			pi.dynamic_state.dynamicStateCount = static_cast<unsigned>(next_pipeline->dynamic_states.size());
@@ -508,7 +737,15 @@ namespace vuk {
 
 			current_pipeline = ptc.acquire_pipeline(pi);
 
-			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, current_pipeline->pipeline);
+			auto& state = bound[0];
+			if (state.pipeline != current_pipeline->pipeline) {
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, current_pipeline->pipeline);
+				bind_stats.issued++;
+				state.pipeline = current_pipeline->pipeline;
+				_switch_layout(state, current_pipeline->pipeline_layout, current_pipeline->layout_info, current_pipeline->push_constant_hash);
+			} else {
+				bind_stats.skipped++;
+			}
 			next_pipeline = nullptr;
 		}
 		_bind_state(true);
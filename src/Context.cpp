@@ -10,13 +10,72 @@
 #include "vuk/Program.hpp"
 #include "vuk/Exception.hpp"
 
-vuk::Context::Context(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device, VkQueue graphics) :
+vuk::Context::Context(VkInstance instance, VkDevice device, VkPhysicalDevice physical_device, VkQueue graphics, uint32_t graphics_queue_family_index, VkQueue compute, uint32_t compute_queue_family_index) :
 	instance(instance),
 	device(device),
 	physical_device(physical_device),
 	graphics_queue(graphics),
+	graphics_queue_family_index(graphics_queue_family_index),
+	compute_queue(compute),
+	compute_queue_family_index(compute_queue_family_index),
 	debug(*this),
 	impl(new ContextImpl(*this)) {
+	cmdBeginRenderingKHR = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR");
+	cmdEndRenderingKHR = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR");
+	cmdPipelineBarrier2KHR = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR");
+	cmdPushDescriptorSetKHR = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR");
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+	timestamp_period = properties.limits.timestampPeriod;
+	uint32_t family_count;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> families(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+	graphics_timestamp_valid_bits = families[graphics_queue_family_index].timestampValidBits;
+	if (compute_queue_family_index != VK_QUEUE_FAMILY_IGNORED) {
+		compute_timestamp_valid_bits = families[compute_queue_family_index].timestampValidBits;
+	}
+}
+
+// flag the set the pipeline pushes, if any
+static void select_push_descriptor_set(vuk::Context& ctx, vuk::fixed_vector<vuk::DescriptorSetLayoutCreateInfo, VUK_MAX_SETS>& dslcis, const vuk::PipelineBaseCreateInfoBase& bci) {
+	if (!ctx.cmdPushDescriptorSetKHR) {
+		return;
+	}
+	auto chosen = bci.push_descriptor_set;
+	if (chosen == (unsigned)-1 && ctx.push_descriptor_max_bindings > 0) {
+		for (auto& dsl : dslcis) {
+			bool small = dsl.bindings.size() > 0 && dsl.bindings.size() <= ctx.push_descriptor_max_bindings && dsl.flags.empty();
+			for (auto& b : dsl.bindings) {
+				small = small && b.descriptorCount == 1;
+			}
+			if (small) {
+				chosen = (unsigned)dsl.index;
+			}
+		}
+	}
+	for (auto& dsl : dslcis) {
+		if (dsl.index == chosen && dsl.bindings.size() > 0) {
+			assert(dsl.flags.empty() && "push descriptor sets can't have binding flags");
+			dsl.dslci.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+		}
+	}
+}
+
+// turn uniform buffers into dynamic ones, except in push descriptor sets and sets with binding flags, which can't have them
+static void select_dynamic_uniform_buffers(vuk::Context& ctx, vuk::fixed_vector<vuk::DescriptorSetLayoutCreateInfo, VUK_MAX_SETS>& dslcis) {
+	uint32_t budget = ctx.max_dynamic_uniform_buffers;
+	for (auto& dsl : dslcis) {
+		if ((dsl.dslci.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) || !dsl.flags.empty()) {
+			continue;
+		}
+		for (auto& b : dsl.bindings) {
+			if (b.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && b.descriptorCount <= budget) {
+				b.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+				budget -= b.descriptorCount;
+			}
+		}
+	}
 }
 
 bool vuk::Context::DebugUtils::enabled() {
@@ -58,6 +117,77 @@ void vuk::Context::submit_transfer(VkSubmitInfo si, VkFence fence) {
 	vkQueueSubmit(transfer_queue, 1, &si, fence);
 }
 
+void vuk::Context::submit_compute(VkSubmitInfo si, VkFence fence) {
+	std::lock_guard _(impl->compute_queue_lock);
+	vkQueueSubmit(compute_queue, 1, &si, fence);
+}
+
+bool vuk::Context::has_async_compute() const {
+	return compute_queue != VK_NULL_HANDLE && compute_queue != graphics_queue;
+}
+
+std::vector<vuk::GPUTiming> vuk::Context::get_gpu_timings() {
+	std::lock_guard _(impl->queries_lock);
+	return impl->gpu_timings;
+}
+
+uint32_t vuk::SetBinding::fill_writes(std::span<VkWriteDescriptorSet, VUK_MAX_BINDINGS> writes, VkDescriptorSet dst) const {
+	uint32_t count = 0;
+	for (unsigned i = 0; i < VUK_MAX_BINDINGS; i++) {
+		if (!used.test(i)) continue;
+		auto& write = writes[count++];
+		write = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		auto& binding = bindings[i];
+		write.descriptorType = (VkDescriptorType)binding.type;
+		write.dstArrayElement = 0;
+		write.descriptorCount = 1;
+		write.dstBinding = i;
+		write.dstSet = dst;
+		switch (binding.type) {
+		case vuk::DescriptorType::eUniformBuffer:
+		case vuk::DescriptorType::eUniformBufferDynamic:
+		case vuk::DescriptorType::eStorageBuffer:
+			write.pBufferInfo = &binding.buffer;
+			break;
+		case vuk::DescriptorType::eSampledImage:
+		case vuk::DescriptorType::eSampler:
+		case vuk::DescriptorType::eCombinedImageSampler:
+		case vuk::DescriptorType::eStorageImage:
+		case vuk::DescriptorType::eInputAttachment:
+			write.pImageInfo = &binding.image.dii;
+			break;
+		default:
+			assert(0);
+		}
+	}
+	return count;
+}
+
+void vuk::SetBinding::fill_update_slots(std::span<DescriptorUpdateSlot, VUK_MAX_BINDINGS> slots) const {
+	assert(used.to_ulong() == layout_info.template_mask);
+	unsigned slot = 0;
+	for (unsigned i = 0; i < VUK_MAX_BINDINGS; i++) {
+		if (!used.test(i)) continue;
+		auto& binding = bindings[i];
+		switch (binding.type) {
+		case vuk::DescriptorType::eUniformBuffer:
+		case vuk::DescriptorType::eUniformBufferDynamic:
+		case vuk::DescriptorType::eStorageBuffer:
+			slots[slot++].buffer = binding.buffer;
+			break;
+		case vuk::DescriptorType::eSampledImage:
+		case vuk::DescriptorType::eSampler:
+		case vuk::DescriptorType::eCombinedImageSampler:
+		case vuk::DescriptorType::eStorageImage:
+		case vuk::DescriptorType::eInputAttachment:
+			slots[slot++].image = binding.image.dii;
+			break;
+		default:
+			assert(0);
+		}
+	}
+}
+
 void vuk::PersistentDescriptorSet::update_combined_image_sampler(PerThreadContext& ptc, unsigned binding, unsigned array_index, vuk::ImageView iv, vuk::SamplerCreateInfo sci, vuk::ImageLayout layout) {
 	descriptor_bindings[array_index].image = vuk::DescriptorImageInfo(ptc.acquire_sampler(sci), iv, layout);
 	descriptor_bindings[array_index].type = vuk::DescriptorType::eCombinedImageSampler;
@@ -138,6 +268,8 @@ vuk::PipelineBaseInfo vuk::Context::create(const create_info_t<PipelineBaseInfo>
 	// acquire pipeline layout
 	vuk::PipelineLayoutCreateInfo plci;
 	plci.dslcis = vuk::PipelineBaseCreateInfo::build_descriptor_layouts(accumulated_reflection, cinfo);
+	select_push_descriptor_set(*this, plci.dslcis, cinfo);
+	select_dynamic_uniform_buffers(*this, plci.dslcis);
 	plci.pcrs.insert(plci.pcrs.begin(), accumulated_reflection.push_constant_ranges.begin(), accumulated_reflection.push_constant_ranges.end());
 	plci.plci.pushConstantRangeCount = (uint32_t)accumulated_reflection.push_constant_ranges.size();
 	plci.plci.pPushConstantRanges = accumulated_reflection.push_constant_ranges.data();
@@ -186,6 +318,8 @@ vuk::ComputePipelineInfo vuk::Context::create(const create_info_t<vuk::ComputePi
 
 	vuk::PipelineLayoutCreateInfo plci;
 	plci.dslcis = vuk::PipelineBaseCreateInfo::build_descriptor_layouts(sm.reflection_info, cinfo);
+	select_push_descriptor_set(*this, plci.dslcis, cinfo);
+	select_dynamic_uniform_buffers(*this, plci.dslcis);
 	plci.pcrs.insert(plci.pcrs.begin(), sm.reflection_info.push_constant_ranges.begin(), sm.reflection_info.push_constant_ranges.end());
 	plci.plci.pushConstantRangeCount = (uint32_t)sm.reflection_info.push_constant_ranges.size();
 	plci.plci.pPushConstantRanges = sm.reflection_info.push_constant_ranges.data();
@@ -213,7 +347,7 @@ vuk::ComputePipelineInfo vuk::Context::create(const create_info_t<vuk::ComputePi
 	VkPipeline pipeline;
 	vkCreateComputePipelines(device, impl->vk_pipeline_cache, 1, &cpci, nullptr, &pipeline);
 	debug.set_name(pipeline, pipe_name);
-	return { { pipeline, cpci.layout, dslai }, sm.reflection_info.local_size };
+	return { { pipeline, cpci.layout, dslai, std::hash<std::vector<VkPushConstantRange>>()(sm.reflection_info.push_constant_ranges) }, sm.reflection_info.local_size };
 }
 
 bool vuk::Context::load_pipeline_cache(std::span<uint8_t> data) {
@@ -235,9 +369,41 @@ std::vector<uint8_t> vuk::Context::save_pipeline_cache() {
 vuk::DescriptorSetLayoutAllocInfo vuk::Context::create(const create_info_t<vuk::DescriptorSetLayoutAllocInfo>& cinfo) {
 	vuk::DescriptorSetLayoutAllocInfo ret;
 	vkCreateDescriptorSetLayout(device, &cinfo.dslci, nullptr, &ret.layout);
+	ret.push_descriptor = cinfo.dslci.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+	// sets of single descriptors are written with a template, reading one slot per binding in binding order
+	bool templatable = !ret.push_descriptor && cinfo.flags.empty() && cinfo.bindings.size() > 0;
+	for (auto& b : cinfo.bindings) {
+		templatable = templatable && b.descriptorCount == 1 && b.binding < VUK_MAX_BINDINGS && b.descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER &&
+			b.descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+	}
+	if (templatable) {
+		std::vector<VkDescriptorSetLayoutBinding> sorted(cinfo.bindings.begin(), cinfo.bindings.end());
+		std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) { return a.binding < b.binding; });
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+		for (auto& b : sorted) {
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding = b.binding;
+			entry.dstArrayElement = 0;
+			entry.descriptorCount = 1;
+			entry.descriptorType = b.descriptorType;
+			entry.offset = entries.size() * sizeof(vuk::DescriptorUpdateSlot);
+			entry.stride = sizeof(vuk::DescriptorUpdateSlot);
+			entries.push_back(entry);
+			ret.template_mask |= 1u << b.binding;
+		}
+		VkDescriptorUpdateTemplateCreateInfo dutci{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+		dutci.descriptorUpdateEntryCount = (uint32_t)entries.size();
+		dutci.pDescriptorUpdateEntries = entries.data();
+		dutci.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		dutci.descriptorSetLayout = ret.layout;
+		vkCreateDescriptorUpdateTemplate(device, &dutci, nullptr, &ret.update_template);
+	}
 	for (size_t i = 0; i < cinfo.bindings.size(); i++) {
 		auto& b = cinfo.bindings[i];
 		// if this is not a variable count binding, add it to the descriptor count
+		if (b.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
+			ret.dynamic_mask |= 1u << b.binding;
+		}
 		if (cinfo.flags.size() <= i || !(cinfo.flags[i] & to_integral(vuk::DescriptorBindingFlagBits::eVariableDescriptorCount))) {
 			ret.descriptor_counts[to_integral(b.descriptorType)] += b.descriptorCount;
 		} else { // a variable count binding
@@ -500,6 +666,20 @@ void vuk::Context::destroy(const RGImage& image) {
 	impl->allocator.destroy_image(image.image);
 }
 
+void vuk::Context::destroy(const TransientHeap& heap) {
+	for (auto& image : heap.images) {
+		vkDestroyImageView(device, image.image_view.payload, nullptr);
+		vkDestroyImage(device, image.image, nullptr);
+	}
+	for (auto& memory : heap.memory) {
+		impl->allocator.free_image_memory(memory);
+	}
+}
+
+void vuk::Context::destroy(const TransientBuffers& buffers) {
+	impl->allocator.free_buffer(buffers.buffer);
+}
+
 void vuk::Context::destroy(const PoolAllocator& v) {
 	impl->allocator.destroy(v);
 }
@@ -523,6 +703,9 @@ void vuk::Context::destroy(const vuk::ShaderModule& sm) {
 }
 
 void vuk::Context::destroy(const vuk::DescriptorSetLayoutAllocInfo& ds) {
+	if (ds.update_template != VK_NULL_HANDLE) {
+		vkDestroyDescriptorUpdateTemplate(device, ds.update_template, nullptr);
+	}
 	vkDestroyDescriptorSetLayout(device, ds.layout, nullptr);
 }
 
@@ -568,6 +751,25 @@ vuk::Context::~Context() {
 			vkDestroyCommandPool(device, cp, nullptr);
 		}
 	}
+	for (auto& pool : impl->static_pass_pools) {
+		if (pool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(device, pool, nullptr);
+		}
+	}
+	for (auto& [name, history] : impl->histories) {
+		for (size_t i = 0; i < history.images.size(); i++) {
+			vkDestroyImageView(device, history.views[i].payload, nullptr);
+			impl->allocator.destroy_image(history.images[i]);
+		}
+	}
+	for (auto& fq : impl->frame_queries) {
+		for (auto& slot : fq.timestamp_pools) {
+			vkDestroyQueryPool(device, slot.pool, nullptr);
+		}
+		for (auto& slot : fq.statistics_pools) {
+			vkDestroyQueryPool(device, slot.pool, nullptr);
+		}
+	}
 	vkDestroyPipelineCache(device, impl->vk_pipeline_cache, nullptr);
 	delete impl;
 }
@@ -3,12 +3,14 @@
 
 #include <mutex>
 #include <queue>
+#include <deque>
 #include <string_view>
 
 #include "Allocator.hpp"
 #include "Pool.hpp"
 #include "Cache.hpp"
 #include "RenderPass.hpp"
+#include "RenderGraphImpl.hpp"
 
 namespace vuk {
 	struct ContextImpl {
@@ -16,9 +18,11 @@ namespace vuk {
 
 		std::mutex gfx_queue_lock;
 		std::mutex xfer_queue_lock;
+		std::mutex compute_queue_lock;
 		Pool<VkCommandBuffer, Context::FC> cbuf_pools;
 		Pool<VkSemaphore, Context::FC> semaphore_pools;
 		Pool<VkFence, Context::FC> fence_pools;
+		Pool<VkEvent, Context::FC> event_pools;
 		VkPipelineCache vk_pipeline_cache;
 		Cache<PipelineBaseInfo> pipelinebase_cache;
 		Cache<PipelineInfo> pipeline_cache;
@@ -26,6 +30,8 @@ namespace vuk {
 		Cache<VkRenderPass> renderpass_cache;
 		Cache<VkFramebuffer> framebuffer_cache;
 		Cache<RGImage> transient_images;
+		Cache<TransientHeap> transient_heaps;
+		PerFrameCache<TransientBuffers, Context::FC> transient_buffers;
 		PerFrameCache<LinearAllocator, Context::FC> scratch_buffers;
 		Cache<vuk::DescriptorPool> pool_cache;
 		PerFrameCache<vuk::DescriptorSet, Context::FC> descriptor_sets;
@@ -48,6 +54,61 @@ namespace vuk {
 		std::unordered_map<std::string_view, vuk::PipelineBaseInfo*> named_pipelines;
 		std::unordered_map<std::string_view, vuk::ComputePipelineInfo*> named_compute_pipelines;
 
+		// arenas of destroyed rendergraphs, reset and ready for reuse
+		std::mutex arenas_lock;
+		std::vector<std::unique_ptr<arena>> arenas;
+
+		// compiled rendergraphs by hash of their structure key, dropped when not linked for a few frames
+		std::mutex compiled_rgs_lock;
+		std::unordered_multimap<size_t, std::unique_ptr<CompiledRenderGraph>> compiled_rgs;
+
+		// copies of the history images, by name, kept for the lifetime of the Context
+		// the first copy is the current frame's, they are rotated once per frame
+		struct HistoryImage {
+			ImageCreateInfo ici;
+			std::vector<Image> images;
+			std::vector<ImageView> views;
+			// use each copy was left in by the last graph using it
+			std::vector<Resource::Use> states;
+			size_t rotated_frame = 0;
+		};
+		std::mutex histories_lock;
+		std::unordered_map<std::string, HistoryImage> histories;
+
+		// query pools of the profiled executions of each frame, the i-th execution of a frame reuses the i-th pools
+		// results are read back when the frame comes around again, into gpu_timings
+		struct QueryPoolSlot {
+			VkQueryPool pool = VK_NULL_HANDLE;
+			uint32_t count = 0;
+			VkQueryPipelineStatisticFlags statistics = 0;
+		};
+		struct FrameQueries {
+			std::vector<QueryPoolSlot> timestamp_pools;
+			std::vector<QueryPoolSlot> statistics_pools;
+			std::deque<ProfiledExecution> executions;
+		};
+		std::mutex queries_lock;
+		std::array<FrameQueries, Context::FC> frame_queries;
+		std::vector<GPUTiming> gpu_timings;
+
+		// secondary command buffers of static passes by pass name, recorded once per key and replayed until invalidated or unused
+		struct StaticPass {
+			uint64_t version;
+			// renderpass compatibility and non-attachment resources the pass was recorded with
+			size_t key;
+			Domain domain;
+			size_t last_use;
+			VkCommandBuffer command_buffer;
+			// descriptor sets created by the recording, they live as long as the command buffer
+			std::vector<DescriptorSet> descriptor_sets;
+		};
+		std::mutex static_passes_lock;
+		// one pool per Domain, created on first use
+		std::array<VkCommandPool, 2> static_pass_pools = {};
+		std::unordered_map<std::string, std::vector<StaticPass>> static_passes;
+		// invalidated or evicted static passes, released when their frame comes around again
+		std::array<std::vector<StaticPass>, Context::FC> static_pass_recycle;
+
 		std::mutex swapchains_lock;
 		plf::colony<Swapchain> swapchains;
 
@@ -60,12 +121,15 @@ namespace vuk {
 			cbuf_pools(ctx),
 			semaphore_pools(ctx),
 			fence_pools(ctx),
+			event_pools(ctx),
 			pipelinebase_cache(ctx),
 			pipeline_cache(ctx),
 			compute_pipeline_cache(ctx),
 			renderpass_cache(ctx),
 			framebuffer_cache(ctx),
 			transient_images(ctx),
+			transient_heaps(ctx),
+			transient_buffers(ctx),
 			scratch_buffers(ctx),
 			pool_cache(ctx),
 			descriptor_sets(ctx),
@@ -222,12 +286,15 @@ namespace vuk {
 		Pool<VkFence, Context::FC>::PFView fence_pools; // must be first, so we wait for the fences
 		Pool<VkCommandBuffer, Context::FC>::PFView commandbuffer_pools;
 		Pool<VkSemaphore, Context::FC>::PFView semaphore_pools;
+		Pool<VkEvent, Context::FC>::PFView event_pools;
 		Cache<PipelineInfo>::PFView pipeline_cache;
 		Cache<ComputePipelineInfo>::PFView compute_pipeline_cache;
 		Cache<PipelineBaseInfo>::PFView pipelinebase_cache;
 		Cache<VkRenderPass>::PFView renderpass_cache;
 		Cache<VkFramebuffer>::PFView framebuffer_cache;
 		Cache<vuk::RGImage>::PFView transient_images;
+		Cache<vuk::TransientHeap>::PFView transient_heaps;
+		PerFrameCache<vuk::TransientBuffers, Context::FC>::PFView transient_buffers;
 		PerFrameCache<LinearAllocator, Context::FC>::PFView scratch_buffers;
 		PerFrameCache<vuk::DescriptorSet, Context::FC>::PFView descriptor_sets;
 		Cache<vuk::Sampler>::PFView sampler_cache;
@@ -252,12 +319,15 @@ namespace vuk {
 			fence_pools(ctx.impl->fence_pools.get_view(ifc)), // must be first, so we wait for the fences
 			commandbuffer_pools(ctx.impl->cbuf_pools.get_view(ifc)),
 			semaphore_pools(ctx.impl->semaphore_pools.get_view(ifc)),
+			event_pools(ctx.impl->event_pools.get_view(ifc)),
 			pipeline_cache(ifc, ctx.impl->pipeline_cache),
 			compute_pipeline_cache(ifc, ctx.impl->compute_pipeline_cache),
 			pipelinebase_cache(ifc, ctx.impl->pipelinebase_cache),
 			renderpass_cache(ifc, ctx.impl->renderpass_cache),
 			framebuffer_cache(ifc, ctx.impl->framebuffer_cache),
 			transient_images(ifc, ctx.impl->transient_images),
+			transient_heaps(ifc, ctx.impl->transient_heaps),
+			transient_buffers(ifc, ctx.impl->transient_buffers),
 			scratch_buffers(ifc, ctx.impl->scratch_buffers),
 			descriptor_sets(ifc, ctx.impl->descriptor_sets),
 			sampler_cache(ifc, ctx.impl->sampler_cache),
@@ -273,12 +343,15 @@ namespace vuk {
 		Pool<VkCommandBuffer, Context::FC>::PFPTView commandbuffer_pool;
 		Pool<VkSemaphore, Context::FC>::PFPTView semaphore_pool;
 		Pool<VkFence, Context::FC>::PFPTView fence_pool;
+		Pool<VkEvent, Context::FC>::PFPTView event_pool;
 		Cache<PipelineInfo>::PFPTView pipeline_cache;
 		Cache<ComputePipelineInfo>::PFPTView compute_pipeline_cache;
 		Cache<PipelineBaseInfo>::PFPTView pipelinebase_cache;
 		Cache<VkRenderPass>::PFPTView renderpass_cache;
 		Cache<VkFramebuffer>::PFPTView framebuffer_cache;
 		Cache<vuk::RGImage>::PFPTView transient_images;
+		Cache<vuk::TransientHeap>::PFPTView transient_heaps;
+		PerFrameCache<vuk::TransientBuffers, Context::FC>::PFPTView transient_buffers;
 		PerFrameCache<LinearAllocator, Context::FC>::PFPTView scratch_buffers;
 		PerFrameCache<vuk::DescriptorSet, Context::FC>::PFPTView descriptor_sets;
 		Cache<vuk::Sampler>::PFPTView sampler_cache;
@@ -297,12 +370,15 @@ namespace vuk {
 			commandbuffer_pool(ifc.impl->commandbuffer_pools.get_view(ptc)),
 			semaphore_pool(ifc.impl->semaphore_pools.get_view(ptc)),
 			fence_pool(ifc.impl->fence_pools.get_view(ptc)),
+			event_pool(ifc.impl->event_pools.get_view(ptc)),
 			pipeline_cache(ptc, ifc.impl->pipeline_cache),
 			compute_pipeline_cache(ptc, ifc.impl->compute_pipeline_cache),
 			pipelinebase_cache(ptc, ifc.impl->pipelinebase_cache),
 			renderpass_cache(ptc, ifc.impl->renderpass_cache),
 			framebuffer_cache(ptc, ifc.impl->framebuffer_cache),
 			transient_images(ptc, ifc.impl->transient_images),
+			transient_heaps(ptc, ifc.impl->transient_heaps),
+			transient_buffers(ptc, ifc.impl->transient_buffers),
 			scratch_buffers(ptc, ifc.impl->scratch_buffers),
 			descriptor_sets(ptc, ifc.impl->descriptor_sets),
 			sampler_cache(ptc, ifc.impl->sampler_cache),
@@ -6,6 +6,8 @@
 #include "Allocator.hpp"
 #include "RenderGraphImpl.hpp"
 #include <unordered_set>
+#include <algorithm>
+#include <optional>
 
 namespace vuk {
 	ExecutableRenderGraph::ExecutableRenderGraph(RenderGraph&& rg) : impl(rg.impl) {
@@ -22,52 +24,512 @@ namespace vuk {
 		delete impl;
 	}
 
-	void ExecutableRenderGraph::create_attachment(PerThreadContext& ptc, Name name, AttachmentRPInfo& attachment_info, vuk::Extent2D fb_extent, vuk::SampleCountFlagBits samples) {
-		auto& chain = impl->use_chains.at(name);
-		if (attachment_info.type == AttachmentRPInfo::Type::eInternal) {
-			vuk::ImageUsageFlags usage = RenderGraph::compute_usage(std::span(chain));
+	// an attachment only used as a framebuffer attachment inside a single renderpass is never loaded from or stored to memory
+	// (internal attachments start cleared or undefined and end undefined), so it can be a transient attachment in lazily allocated memory
+	bool is_memoryless(const RGImpl& impl, std::span<const UseRef> chain, vuk::ImageUsageFlags usage) {
+		const vuk::ImageUsageFlags attachment_usage = vuk::ImageUsageFlagBits::eColorAttachment | vuk::ImageUsageFlagBits::eDepthStencilAttachment | vuk::ImageUsageFlagBits::eInputAttachment;
+		if ((VkImageUsageFlags)usage & ~(VkImageUsageFlags)attachment_usage)
+			return false;
+		size_t rp = SIZE_MAX;
+		for (auto& ur : chain) {
+			if (!ur.pass)
+				continue;
+			if (!is_framebuffer_attachment(ur.use) || (rp != SIZE_MAX && ur.pass->render_pass_index != rp))
+				return false;
+			rp = ur.pass->render_pass_index;
+		}
+		return rp != SIZE_MAX && !impl.rpis[rp].framebufferless;
+	}
 
-			vuk::ImageCreateInfo ici;
-			ici.usage = usage;
-			ici.arrayLayers = 1;
-			// compute extent
-			if (attachment_info.extents.sizing == Sizing::eRelative) {
-				assert(fb_extent.width > 0 && fb_extent.height > 0);
-				ici.extent = vuk::Extent3D{ static_cast<uint32_t>(attachment_info.extents._relative.width * fb_extent.width), static_cast<uint32_t>(attachment_info.extents._relative.height * fb_extent.height), 1u };
-			} else {
-				ici.extent = static_cast<vuk::Extent3D>(attachment_info.extents.extent);
-			}
-			// concretize attachment size
-			attachment_info.extents = Dimension2D::absolute(ici.extent.width, ici.extent.height);
-			ici.imageType = vuk::ImageType::e2D;
-			ici.format = vuk::Format(attachment_info.description.format);
-			ici.mipLevels = 1;
-			ici.initialLayout = vuk::ImageLayout::eUndefined;
-			ici.samples = samples;
-			ici.sharingMode = vuk::SharingMode::eExclusive;
-			ici.tiling = vuk::ImageTiling::eOptimal;
-
-			vuk::ImageViewCreateInfo ivci;
-			ivci.image = vuk::Image{};
-			ivci.format = vuk::Format(attachment_info.description.format);
-			ivci.viewType = vuk::ImageViewType::e2D;
-			vuk::ImageSubresourceRange isr;
-
-			isr.aspectMask = format_to_aspect(ici.format);
-			isr.baseArrayLayer = 0;
-			isr.layerCount = 1;
-			isr.baseMipLevel = 0;
-			isr.levelCount = 1;
-			ivci.subresourceRange = isr;
-
-			RGCI rgci;
-			rgci.name = name;
-			rgci.ici = ici;
-			rgci.ivci = ivci;
-
-			auto rg = ptc.acquire_rendertarget(rgci);
-			attachment_info.iv = rg.image_view;
-			attachment_info.image = rg.image;
+	RGCI ExecutableRenderGraph::describe_attachment(uint32_t id, AttachmentRPInfo& attachment_info, vuk::Extent2D fb_extent, vuk::SampleCountFlagBits samples) {
+		auto& chain = impl->use_chains[id];
+		vuk::ImageUsageFlags usage = RenderGraph::compute_usage(std::span(chain));
+		if (is_memoryless(*impl, chain, usage)) {
+			usage |= vuk::ImageUsageFlagBits::eTransientAttachment;
+		}
+
+		vuk::ImageCreateInfo ici;
+		ici.usage = usage;
+		// enough mips and layers for every subrange the passes use
+		ici.mipLevels = 1;
+		ici.arrayLayers = 1;
+		for (auto& ur : chain) {
+			auto& sr = ur.subrange;
+			ici.mipLevels = std::max(ici.mipLevels, sr.base_level + (sr.level_count == VK_REMAINING_MIP_LEVELS ? 1 : sr.level_count));
+			ici.arrayLayers = std::max(ici.arrayLayers, sr.base_layer + (sr.layer_count == VK_REMAINING_ARRAY_LAYERS ? 1 : sr.layer_count));
+		}
+		// compute extent
+		if (attachment_info.extents.sizing == Sizing::eRelative) {
+			assert(fb_extent.width > 0 && fb_extent.height > 0);
+			ici.extent = vuk::Extent3D{ static_cast<uint32_t>(attachment_info.extents._relative.width * fb_extent.width), static_cast<uint32_t>(attachment_info.extents._relative.height * fb_extent.height), 1u };
+		} else {
+			ici.extent = static_cast<vuk::Extent3D>(attachment_info.extents.extent);
+		}
+		// concretize attachment size
+		attachment_info.extents = Dimension2D::absolute(ici.extent.width, ici.extent.height);
+		ici.imageType = vuk::ImageType::e2D;
+		ici.format = vuk::Format(attachment_info.description.format);
+		ici.initialLayout = vuk::ImageLayout::eUndefined;
+		ici.samples = samples;
+		ici.sharingMode = vuk::SharingMode::eExclusive;
+		ici.tiling = vuk::ImageTiling::eOptimal;
+
+		vuk::ImageViewCreateInfo ivci;
+		ivci.image = vuk::Image{};
+		ivci.format = vuk::Format(attachment_info.description.format);
+		ivci.viewType = vuk::ImageViewType::e2D;
+		vuk::ImageSubresourceRange isr;
+
+		isr.aspectMask = format_to_aspect(ici.format);
+		isr.baseArrayLayer = 0;
+		isr.layerCount = 1;
+		isr.baseMipLevel = 0;
+		isr.levelCount = 1;
+		ivci.subresourceRange = isr;
+
+		RGCI rgci;
+		rgci.name = impl->resource_names[id];
+		rgci.ici = ici;
+		rgci.ivci = ivci;
+		return rgci;
+	}
+
+	// renderpasses and uses at both ends of a transient's lifetime
+	// [alias_first, alias_last] is the range of renderpasses the memory can't be shared in, see widen_lifetime
+	struct TransientLifetime {
+		uint32_t first_rp, last_rp;
+		Resource::Use first, last;
+		uint32_t alias_first, alias_last;
+	};
+
+	// ordered[b][a] if batch a finishes before batch b starts on the device: a is earlier on the same queue, or b waits on a (transitively)
+	std::vector<std::vector<bool>> order_batches(const RGImpl& impl) {
+		auto& batches = impl.batches;
+		std::vector<std::vector<bool>> ordered(batches.size(), std::vector<bool>(batches.size(), false));
+		for (size_t b = 0; b < batches.size(); b++) {
+			auto inherit = [&](size_t a) {
+				ordered[b][a] = true;
+				for (size_t k = 0; k < a; k++) {
+					if (ordered[a][k])
+						ordered[b][k] = true;
+				}
+			};
+			for (size_t a = 0; a < b; a++) {
+				if (batches[a].domain == batches[b].domain)
+					inherit(a);
+			}
+			for (auto& [a, stages] : batches[b].waits) {
+				inherit(a);
+			}
+		}
+		return ordered;
+	}
+
+	// renderpass order is only execution order within a queue: a batch on the other queue that is not ordered with the batches of the lifetime
+	// may run concurrently with them, so the range is widened over the whole of such batches
+	void widen_lifetime(const RGImpl& impl, const std::vector<std::vector<bool>>& ordered, TransientLifetime& lt) {
+		auto first_batch = impl.rpis[lt.first_rp].batch;
+		auto last_batch = impl.rpis[lt.last_rp].batch;
+		lt.alias_first = lt.first_rp;
+		lt.alias_last = lt.last_rp;
+		for (size_t b = 0; b < first_batch; b++) {
+			if (impl.batches[b].rp_begin != impl.batches[b].rp_end && !ordered[first_batch][b]) {
+				lt.alias_first = (uint32_t)impl.batches[b].rp_begin;
+				break;
+			}
+		}
+		for (size_t b = impl.batches.size(); b-- > last_batch + 1;) {
+			if (impl.batches[b].rp_begin != impl.batches[b].rp_end && !ordered[b][last_batch]) {
+				lt.alias_last = (uint32_t)impl.batches[b].rp_end - 1;
+				break;
+			}
+		}
+	}
+
+	// the last use of an aliased resource on the other queue is ordered by a semaphore wait, which the aliasing barrier has to chain with
+	void add_aliasing_src(const RGImpl& impl, const TransientLifetime& dead, const TransientLifetime& alive, MemoryBarrier& mb) {
+		if (impl.batches[impl.rpis[dead.last_rp].batch].domain != impl.batches[impl.rpis[alive.first_rp].batch].domain) {
+			mb.src |= vuk::PipelineStageFlagBits::eAllCommands;
+		} else {
+			mb.src |= dead.last.stages;
+		}
+		mb.barrier.srcAccessMask |= (VkAccessFlags)dead.last.access;
+	}
+
+	TransientLifetime compute_lifetime(std::span<const UseRef> chain) {
+		TransientLifetime lt{ UINT32_MAX, 0 };
+		for (auto& useref : chain) {
+			if (!useref.pass)
+				continue;
+			auto rp = (uint32_t)useref.pass->render_pass_index;
+			if (rp < lt.first_rp) {
+				lt.first_rp = rp;
+				lt.first = useref.use;
+			}
+			if (rp >= lt.last_rp) {
+				lt.last_rp = rp;
+				lt.last = useref.use;
+			}
+		}
+		return lt;
+	}
+
+	void ExecutableRenderGraph::create_transients(PerThreadContext& ptc, std::span<std::pair<uint32_t, RGCI>> transients) {
+		TransientHeapCreateInfo thci;
+		std::vector<TransientLifetime> lifetimes;
+		auto ordered = order_batches(*impl);
+		for (auto& [id, rgci] : transients) {
+			auto lt = compute_lifetime(std::span(impl->use_chains[id]));
+			widen_lifetime(*impl, ordered, lt);
+			thci.images.push_back(rgci);
+			thci.lifetimes.emplace_back(lt.alias_first, lt.alias_last);
+			lifetimes.push_back(lt);
+		}
+
+		auto heap = ptc.acquire_transient_heap(thci);
+		for (size_t i = 0; i < transients.size(); i++) {
+			auto& bound = *impl->attachment_slots[transients[i].first];
+			bound.iv = heap.images[i].image_view;
+			bound.image = heap.images[i].image;
+		}
+
+		// a transient placed over the memory of transients that died before it needs to wait for their last use
+		for (size_t i = 0; i < transients.size(); i++) {
+			MemoryBarrier mb{ .barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER } };
+			bool aliased = false;
+			for (size_t j = 0; j < transients.size(); j++) {
+				if (heap.blocks[i] != heap.blocks[j] || lifetimes[j].alias_last >= lifetimes[i].alias_first)
+					continue;
+				if (heap.offsets[j] < heap.offsets[i] + heap.sizes[i] && heap.offsets[i] < heap.offsets[j] + heap.sizes[j]) {
+					aliased = true;
+					add_aliasing_src(*impl, lifetimes[j], lifetimes[i], mb);
+				}
+			}
+			if (!aliased)
+				continue;
+			if (mb.src == vuk::PipelineStageFlags{}) {
+				mb.src = vuk::PipelineStageFlagBits::eTopOfPipe;
+			}
+			// the image's initial layout transition does not belong to any stage, so everything waits
+			mb.dst = vuk::PipelineStageFlagBits::eAllCommands;
+			mb.barrier.dstAccessMask = (VkAccessFlags)lifetimes[i].first.access;
+			impl->rpis[lifetimes[i].first_rp].aliasing_barriers.push_back(mb);
+		}
+	}
+
+	void ExecutableRenderGraph::create_transient_buffers(PerThreadContext& ptc) {
+		// buffers are grouped by usage, each group is suballocated from its own buffer
+		struct Group {
+			TransientBuffersCreateInfo tbci;
+			std::vector<BufferInfo*> managed;
+			std::vector<TransientLifetime> lifetimes;
+		};
+		std::vector<Group> groups;
+		auto ordered = order_batches(*impl);
+		for (auto& [name, bound] : impl->bound_buffers) {
+			// managed buffers only used by culled passes are not allocated
+			if (!bound.managed || impl->use_chains[bound.id].empty())
+				continue;
+			auto lt = compute_lifetime(std::span(impl->use_chains[bound.id]));
+			widen_lifetime(*impl, ordered, lt);
+			auto it = std::find_if(groups.begin(), groups.end(), [&](auto& g) { return g.tbci.usage == bound.usage; });
+			if (it == groups.end()) {
+				it = groups.emplace(groups.end());
+				it->tbci.usage = bound.usage;
+			}
+			it->tbci.sizes.push_back(bound.size);
+			it->tbci.lifetimes.emplace_back(lt.alias_first, lt.alias_last);
+			it->lifetimes.push_back(lt);
+			it->managed.push_back(&bound);
+		}
+
+		for (auto& [tbci, managed, lifetimes] : groups) {
+			auto tb = ptc.acquire_transient_buffers(tbci);
+			for (size_t i = 0; i < managed.size(); i++) {
+				managed[i]->buffer = tb.buffer.subrange(tb.offsets[i], tbci.sizes[i]);
+			}
+
+			// a buffer placed over the memory of buffers that died before it needs to wait for their last use
+			for (size_t i = 0; i < managed.size(); i++) {
+				MemoryBarrier mb{ .barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER } };
+				bool aliased = false;
+				for (size_t j = 0; j < managed.size(); j++) {
+					if (lifetimes[j].alias_last >= lifetimes[i].alias_first)
+						continue;
+					if (tb.offsets[j] < tb.offsets[i] + tbci.sizes[i] && tb.offsets[i] < tb.offsets[j] + tbci.sizes[j]) {
+						aliased = true;
+						add_aliasing_src(*impl, lifetimes[j], lifetimes[i], mb);
+					}
+				}
+				if (!aliased)
+					continue;
+				if (mb.src == vuk::PipelineStageFlags{}) {
+					mb.src = vuk::PipelineStageFlagBits::eTopOfPipe;
+				}
+				mb.dst = lifetimes[i].first.stages;
+				if (mb.dst == vuk::PipelineStageFlags{}) {
+					mb.dst = vuk::PipelineStageFlagBits::eBottomOfPipe;
+				}
+				mb.barrier.dstAccessMask = (VkAccessFlags)lifetimes[i].first.access;
+				impl->rpis[lifetimes[i].first_rp].aliasing_barriers.push_back(mb);
+			}
+		}
+	}
+
+	// queries of a profiled execution
+	// the scopes of a batch are contiguous (its passes, its renderpasses, then its barrier batches), so every batch resets its own queries before writing them
+	struct Profiler {
+		ProfiledExecution& execution;
+		// pass index -> scope
+		std::vector<uint32_t> pass_scopes;
+		std::vector<uint32_t> rp_scopes;
+		// batch -> first scope, with the scope count at the end
+		std::vector<uint32_t> batch_scopes;
+		// batch -> first barrier scope
+		std::vector<uint32_t> barrier_scopes;
+		uint32_t next_barrier_scope = 0;
+
+		void reset(VkCommandBuffer cbuf, size_t batch) {
+			auto first = batch_scopes[batch];
+			auto count = batch_scopes[batch + 1] - first;
+			if (count > 0) {
+				vkCmdResetQueryPool(cbuf, execution.timestamps, 2 * first, 2 * count);
+				if (execution.statistics != VK_NULL_HANDLE) {
+					vkCmdResetQueryPool(cbuf, execution.statistics, first, count);
+				}
+			}
+			next_barrier_scope = barrier_scopes[batch];
+		}
+
+		// UINT32_MAX in batches on queues without timestamps
+		uint32_t next_barrier() {
+			return next_barrier_scope == UINT32_MAX ? UINT32_MAX : next_barrier_scope++;
+		}
+
+		// scopes are recorded by the thread recording the primary, the timestamps may be written from secondaries
+		// passes, renderpasses and barriers of queues without timestamps have no scope (UINT32_MAX) and are not timed
+		void record(uint32_t scope, GPUTiming::Kind kind, Name name) {
+			if (scope == UINT32_MAX)
+				return;
+			execution.scopes.push_back(ProfiledExecution::Scope{ scope, kind, std::string(name) });
+		}
+
+		void begin(VkCommandBuffer cbuf, uint32_t scope, bool statistics = false) const {
+			if (scope == UINT32_MAX)
+				return;
+			vkCmdWriteTimestamp(cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, execution.timestamps, 2 * scope);
+			if (statistics && execution.statistics != VK_NULL_HANDLE) {
+				vkCmdBeginQuery(cbuf, execution.statistics, scope, 0);
+			}
+		}
+
+		void end(VkCommandBuffer cbuf, uint32_t scope, bool statistics = false) const {
+			if (scope == UINT32_MAX)
+				return;
+			if (statistics && execution.statistics != VK_NULL_HANDLE) {
+				vkCmdEndQuery(cbuf, execution.statistics, scope);
+			}
+			vkCmdWriteTimestamp(cbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, execution.timestamps, 2 * scope + 1);
+		}
+	};
+
+	// lay out the scopes of every batch and acquire queries for them from the frame
+	std::optional<Profiler> begin_profiling(PerThreadContext& ptc, RGImpl& impl) {
+		if (!impl.profiling)
+			return {};
+		std::vector<uint32_t> pass_scopes(impl.passes.size(), UINT32_MAX);
+		std::vector<uint32_t> rp_scopes(impl.rpis.size(), UINT32_MAX);
+		std::vector<uint32_t> batch_scopes;
+		std::vector<uint32_t> barrier_scopes;
+		uint32_t scope = 0;
+		for (auto& batch : impl.batches) {
+			batch_scopes.push_back(scope);
+			auto valid_bits = batch.domain == Domain::eGraphics ? ptc.ctx.graphics_timestamp_valid_bits : ptc.ctx.compute_timestamp_valid_bits;
+			if (valid_bits == 0) {
+				barrier_scopes.push_back(UINT32_MAX);
+				continue;
+			}
+			// queue acquire and release, then aliasing barriers per renderpass, pre- and post-barriers per subpass
+			uint32_t barrier_count = 2;
+			for (size_t rp = batch.rp_begin; rp < batch.rp_end; rp++) {
+				auto& rpass = impl.rpis[rp];
+				barrier_count += 1 + 2 * (uint32_t)rpass.subpasses.size();
+				for (auto& sp : rpass.subpasses) {
+					for (auto& p : sp.passes) {
+						pass_scopes[p - impl.passes.data()] = scope++;
+					}
+				}
+			}
+			for (size_t rp = batch.rp_begin; rp < batch.rp_end; rp++) {
+				rp_scopes[rp] = scope++;
+			}
+			barrier_scopes.push_back(scope);
+			scope += barrier_count;
+		}
+		batch_scopes.push_back(scope);
+		if (scope == 0)
+			return {};
+		auto& execution = ptc.acquire_profiled_execution(scope, impl.profiled_statistics);
+		return Profiler{ execution, std::move(pass_scopes), std::move(rp_scopes), std::move(batch_scopes), std::move(barrier_scopes) };
+	}
+
+	// name of the first pass of a renderpass, to label its scopes
+	Name first_pass_name(const RenderPassInfo& rpass) {
+		for (auto& sp : rpass.subpasses) {
+			if (sp.passes.size() > 0)
+				return sp.passes[0]->pass.name;
+		}
+		return {};
+	}
+
+	// the image a barrier was linked against, and the subresources of the attached view if the barrier covers those
+	void bind_barrier_image(VkImage& image, VkImageSubresourceRange& range, const ImageBarrier& ib, const RGImpl& impl) {
+		auto& bound = *impl.attachment_slots[ib.image];
+		image = bound.image;
+		if (ib.attachment_view) {
+			range.baseMipLevel = bound.base_level;
+			range.baseArrayLayer = bound.base_layer;
+		}
+	}
+
+	DependencyInfo2 to_dependency_info(std::span<const ImageBarrier> image_barriers, std::span<const MemoryBarrier> mem_barriers, std::span<const BufferBarrier> buffer_barriers) {
+		DependencyInfo2 di;
+		// memory barriers with the same stages are merged into one
+		for (auto& dep : mem_barriers) {
+			auto src = src_stages2(dep);
+			auto dst = dst_stages2(dep);
+			auto it = std::find_if(di.memory_barriers.begin(), di.memory_barriers.end(), [&](auto& mb) { return mb.srcStageMask == src && mb.dstStageMask == dst; });
+			if (it == di.memory_barriers.end()) {
+				it = di.memory_barriers.insert(it, VkMemoryBarrier2KHR{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR, .srcStageMask = src, .dstStageMask = dst });
+			}
+			it->srcAccessMask |= dep.barrier.srcAccessMask;
+			it->dstAccessMask |= dep.barrier.dstAccessMask;
+		}
+		for (auto& dep : image_barriers) {
+			auto& b = dep.barrier;
+			di.image_barriers.push_back(VkImageMemoryBarrier2KHR{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+				.srcStageMask = src_stages2(dep), .srcAccessMask = b.srcAccessMask, .dstStageMask = dst_stages2(dep), .dstAccessMask = b.dstAccessMask,
+				.oldLayout = b.oldLayout, .newLayout = b.newLayout, .srcQueueFamilyIndex = b.srcQueueFamilyIndex, .dstQueueFamilyIndex = b.dstQueueFamilyIndex,
+				.image = b.image, .subresourceRange = b.subresourceRange });
+		}
+		for (auto& dep : buffer_barriers) {
+			auto& b = dep.barrier;
+			di.buffer_barriers.push_back(VkBufferMemoryBarrier2KHR{ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
+				.srcStageMask = src_stages2(dep), .srcAccessMask = b.srcAccessMask, .dstStageMask = dst_stages2(dep), .dstAccessMask = b.dstAccessMask,
+				.srcQueueFamilyIndex = b.srcQueueFamilyIndex, .dstQueueFamilyIndex = b.dstQueueFamilyIndex,
+				.buffer = b.buffer, .offset = b.offset, .size = b.size });
+		}
+		return di;
+	}
+
+	// record barriers of one boundary in a single vkCmdPipelineBarrier2
+	void emit_barriers2(PerThreadContext& ptc, VkCommandBuffer cbuf, std::span<const ImageBarrier> image_barriers, std::span<const MemoryBarrier> mem_barriers, RGImpl& impl, std::span<const BufferBarrier> buffer_barriers) {
+		auto di = to_dependency_info(image_barriers, mem_barriers, buffer_barriers);
+		for (size_t i = 0; i < image_barriers.size(); i++) {
+			bind_barrier_image(di.image_barriers[i].image, di.image_barriers[i].subresourceRange, image_barriers[i], impl);
+		}
+		for (size_t i = 0; i < buffer_barriers.size(); i++) {
+			auto& buffer = impl.buffer_slots[buffer_barriers[i].buffer]->buffer;
+			di.buffer_barriers[i].buffer = buffer.buffer;
+			di.buffer_barriers[i].offset = buffer.offset;
+			di.buffer_barriers[i].size = buffer.size;
+		}
+		VkDependencyInfoKHR dep_info{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+		dep_info.memoryBarrierCount = (uint32_t)di.memory_barriers.size();
+		dep_info.pMemoryBarriers = di.memory_barriers.data();
+		dep_info.bufferMemoryBarrierCount = (uint32_t)di.buffer_barriers.size();
+		dep_info.pBufferMemoryBarriers = di.buffer_barriers.data();
+		dep_info.imageMemoryBarrierCount = (uint32_t)di.image_barriers.size();
+		dep_info.pImageMemoryBarriers = di.image_barriers.data();
+		ptc.ctx.cmdPipelineBarrier2KHR(cbuf, &dep_info);
+		ptc.ifc.pipeline_barrier_calls++;
+	}
+
+	// record barriers of one boundary, with synchronization2 if the Context uses it
+	// otherwise with a single vkCmdPipelineBarrier per (src, dst) stage pair, memory barriers with the same stages merged into one
+	// when profiling, the boundary is timed as a scope labelled with scope_name
+	void emit_barriers(PerThreadContext& ptc, VkCommandBuffer cbuf, std::span<const ImageBarrier> image_barriers, std::span<const MemoryBarrier> mem_barriers, RGImpl& impl, std::span<const BufferBarrier> buffer_barriers = {}, Name scope_name = {}) {
+		if (image_barriers.empty() && mem_barriers.empty() && buffer_barriers.empty())
+			return;
+
+		auto* profiler = impl.profiler;
+		uint32_t scope = 0;
+		if (profiler) {
+			scope = profiler->next_barrier();
+			profiler->record(scope, GPUTiming::Kind::eBarriers, scope_name);
+			profiler->begin(cbuf, scope);
+		}
+
+		if (ptc.ctx.use_synchronization2) {
+			assert(ptc.ctx.cmdPipelineBarrier2KHR && "use_synchronization2 needs VK_KHR_synchronization2");
+			emit_barriers2(ptc, cbuf, image_barriers, mem_barriers, impl, buffer_barriers);
+		} else {
+			struct Batch {
+				vuk::PipelineStageFlags src;
+				vuk::PipelineStageFlags dst;
+				bool has_mem_barrier = false;
+				VkMemoryBarrier mem_barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+				std::vector<VkImageMemoryBarrier> image_barriers;
+				std::vector<VkBufferMemoryBarrier> buffer_barriers;
+			};
+			std::vector<Batch> batches;
+			auto batch_for = [&](vuk::PipelineStageFlags src, vuk::PipelineStageFlags dst) -> Batch& {
+				auto it = std::find_if(batches.begin(), batches.end(), [&](auto& b) { return b.src == src && b.dst == dst; });
+				if (it != batches.end())
+					return *it;
+				return batches.emplace_back(Batch{ .src = src, .dst = dst });
+			};
+
+			for (auto& dep : mem_barriers) {
+				auto& batch = batch_for(dep.src, dep.dst);
+				batch.has_mem_barrier = true;
+				batch.mem_barrier.srcAccessMask |= dep.barrier.srcAccessMask;
+				batch.mem_barrier.dstAccessMask |= dep.barrier.dstAccessMask;
+			}
+			for (auto& dep : image_barriers) {
+				auto& batch = batch_for(dep.src, dep.dst);
+				auto& barrier = batch.image_barriers.emplace_back(dep.barrier);
+				bind_barrier_image(barrier.image, barrier.subresourceRange, dep, impl);
+			}
+			for (auto& dep : buffer_barriers) {
+				auto& batch = batch_for(dep.src, dep.dst);
+				auto& barrier = batch.buffer_barriers.emplace_back(dep.barrier);
+				auto& buffer = impl.buffer_slots[dep.buffer]->buffer;
+				barrier.buffer = buffer.buffer;
+				barrier.offset = buffer.offset;
+				barrier.size = buffer.size;
+			}
+
+			for (auto& batch : batches) {
+				vkCmdPipelineBarrier(cbuf, (VkPipelineStageFlags)batch.src, (VkPipelineStageFlags)batch.dst, 0, batch.has_mem_barrier ? 1 : 0, &batch.mem_barrier, (uint32_t)batch.buffer_barriers.size(), batch.buffer_barriers.data(), (uint32_t)batch.image_barriers.size(), batch.image_barriers.data());
+				ptc.ifc.pipeline_barrier_calls++;
+			}
+		}
+
+		if (profiler) {
+			profiler->end(cbuf, scope);
+		}
+	}
+
+	void wait_events(VkCommandBuffer cbuf, std::span<const SplitBarrier> split_barriers, RGImpl& impl) {
+		for (auto& sb : split_barriers) {
+			VkMemoryBarrier mem_barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			for (auto& mb : sb.mem_barriers) {
+				mem_barrier.srcAccessMask |= mb.barrier.srcAccessMask;
+				mem_barrier.dstAccessMask |= mb.barrier.dstAccessMask;
+			}
+			std::vector<VkImageMemoryBarrier> image_barriers;
+			for (auto& ib : sb.image_barriers) {
+				auto& barrier = image_barriers.emplace_back(ib.barrier);
+				bind_barrier_image(barrier.image, barrier.subresourceRange, ib, impl);
+			}
+			vkCmdWaitEvents(cbuf, 1, &impl.events[sb.event], (VkPipelineStageFlags)sb.src, (VkPipelineStageFlags)sb.dst, sb.mem_barriers.size() > 0 ? 1 : 0, &mem_barrier, 0, nullptr, (uint32_t)image_barriers.size(), image_barriers.data());
+		}
+	}
+
+	void set_events(VkCommandBuffer cbuf, std::span<const std::pair<size_t, vuk::PipelineStageFlags>> events, RGImpl& impl) {
+		for (auto& [event, stages] : events) {
+			vkCmdSetEvent(cbuf, impl.events[event], (VkPipelineStageFlags)stages);
 		}
 	}
 
@@ -92,8 +554,61 @@ namespace vuk {
 		vkCmdBeginRenderPass(cbuf, &rbi, use_secondary_command_buffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 	}
 
+	// dynamic rendering counterpart of begin_renderpass, with the attachments as described for the renderpass
+	void begin_rendering(PerThreadContext& ptc, vuk::RenderPassInfo& rpass, VkCommandBuffer cbuf, bool use_secondary_command_buffers) {
+		auto& sd = rpass.rpci.subpass_descriptions[0];
+		auto attachment_info = [&](const VkAttachmentReference& ref) {
+			auto& desc = rpass.rpci.attachments[ref.attachment];
+			auto& att = rpass.attachments[ref.attachment];
+			VkRenderingAttachmentInfoKHR rai{ .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR };
+			rai.imageView = rpass.fbci.attachments[ref.attachment].payload;
+			rai.imageLayout = ref.layout;
+			rai.loadOp = desc.loadOp;
+			rai.storeOp = desc.storeOp;
+			if (att.should_clear)
+				rai.clearValue = att.clear_value.c;
+			return rai;
+		};
+
+		std::vector<VkRenderingAttachmentInfoKHR> colors;
+		for (uint32_t i = 0; i < sd.colorAttachmentCount; i++) {
+			auto& rai = colors.emplace_back(attachment_info(sd.pColorAttachments[i]));
+			if (sd.pResolveAttachments && sd.pResolveAttachments[i].attachment != VK_ATTACHMENT_UNUSED) {
+				auto& resolve = sd.pResolveAttachments[i];
+				// as a renderpass resolve would: integer and depth/stencil formats take sample 0, the others are averaged
+				auto format = (vuk::Format)rpass.rpci.attachments[sd.pColorAttachments[i].attachment].format;
+				rai.resolveMode = format_is_integer(format) || format_to_aspect(format) != vuk::ImageAspectFlagBits::eColor ? VK_RESOLVE_MODE_SAMPLE_ZERO_BIT_KHR : VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+				rai.resolveImageView = rpass.fbci.attachments[resolve.attachment].payload;
+				rai.resolveImageLayout = resolve.layout;
+			}
+		}
+
+		VkRenderingInfoKHR ri{ .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR };
+		ri.flags = use_secondary_command_buffers ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+		ri.renderArea = VkRect2D{ vuk::Offset2D{}, vuk::Extent2D{ rpass.fbci.width, rpass.fbci.height } };
+		ri.layerCount = 1;
+		ri.colorAttachmentCount = (uint32_t)colors.size();
+		ri.pColorAttachments = colors.data();
+		VkRenderingAttachmentInfoKHR depth, stencil;
+		if (sd.pDepthStencilAttachment) {
+			auto& desc = rpass.rpci.attachments[sd.pDepthStencilAttachment->attachment];
+			auto aspect = format_to_aspect((vuk::Format)desc.format);
+			depth = attachment_info(*sd.pDepthStencilAttachment);
+			if (aspect & vuk::ImageAspectFlagBits::eDepth) {
+				ri.pDepthAttachment = &depth;
+			}
+			if (aspect & vuk::ImageAspectFlagBits::eStencil) {
+				stencil = depth;
+				stencil.loadOp = desc.stencilLoadOp;
+				stencil.storeOp = desc.stencilStoreOp;
+				ri.pStencilAttachment = &stencil;
+			}
+		}
+		ptc.ctx.cmdBeginRenderingKHR(cbuf, &ri);
+	}
+
 	void ExecutableRenderGraph::fill_renderpass_info(vuk::RenderPassInfo& rpass, const size_t& i, vuk::CommandBuffer& cobuf) {
-		if (rpass.handle == VK_NULL_HANDLE) {
+		if (rpass.framebufferless) {
 			cobuf.ongoing_renderpass = {};
 			return;
 		}
@@ -112,10 +627,81 @@ namespace vuk {
 		if (rpi.color_attachments.size() == 0) { // depth only pass, samples == 1
 			rpi.samples = vuk::SampleCountFlagBits::e1;
 		}
+		if (rpass.dynamic_rendering) {
+			for (auto& ca : rpi.color_attachments) {
+				rpi.color_formats.push_back(rpass.rpci.attachments[ca.attachment].format);
+			}
+			if (spdesc.pDepthStencilAttachment) {
+				auto format = rpass.rpci.attachments[spdesc.pDepthStencilAttachment->attachment].format;
+				auto aspect = format_to_aspect((vuk::Format)format);
+				if (aspect & vuk::ImageAspectFlagBits::eDepth)
+					rpi.depth_format = format;
+				if (aspect & vuk::ImageAspectFlagBits::eStencil)
+					rpi.stencil_format = format;
+			}
+		}
 		cobuf.ongoing_renderpass = rpi;
 	}
 
-	VkCommandBuffer ExecutableRenderGraph::execute(vuk::PerThreadContext& ptc, std::vector<std::pair<SwapChainRef, size_t>> swp_with_index) {
+	void ExecutableRenderGraph::begin_secondary(VkCommandBuffer scbuf, vuk::RenderPassInfo& rpass, size_t sp, vuk::CommandBuffer& cobuf, VkCommandBufferUsageFlags flags, VkFramebuffer framebuffer) {
+		fill_renderpass_info(rpass, sp, cobuf);
+
+		VkCommandBufferInheritanceInfo cbii{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+		VkCommandBufferBeginInfo cbi{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = flags };
+		if (rpass.handle != VK_NULL_HANDLE) {
+			cbi.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			cbii.renderPass = rpass.handle;
+			cbii.subpass = (uint32_t)sp;
+			cbii.framebuffer = framebuffer;
+		}
+		VkCommandBufferInheritanceRenderingInfoKHR cbiri{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+		if (rpass.dynamic_rendering) {
+			auto& ongoing = *cobuf.ongoing_renderpass;
+			cbi.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			cbiri.colorAttachmentCount = (uint32_t)ongoing.color_formats.size();
+			cbiri.pColorAttachmentFormats = ongoing.color_formats.data();
+			cbiri.depthAttachmentFormat = ongoing.depth_format;
+			cbiri.stencilAttachmentFormat = ongoing.stencil_format;
+			cbiri.rasterizationSamples = (VkSampleCountFlagBits)ongoing.samples;
+			cbii.pNext = &cbiri;
+		}
+		cbi.pInheritanceInfo = &cbii;
+		vkBeginCommandBuffer(scbuf, &cbi);
+	}
+
+	VkCommandBuffer ExecutableRenderGraph::acquire_static_pass(PerThreadContext& ptc, vuk::RenderPassInfo& rpass, size_t sp, PassInfo& pass) {
+		// the recording stays valid for compatible renderpasses of the same size, and the same resources behind the pass's names
+		// framebuffer attachments are inherited from the renderpass instead of recorded, so e.g. a new swapchain image each frame still replays
+		// (input attachments are read through recorded descriptor sets, so they stay in the key)
+		size_t key = 0;
+		hash_combine(key, reinterpret_cast<uint64_t>(rpass.handle), sp, rpass.dynamic_rendering, rpass.fbci.width, rpass.fbci.height);
+		for (auto& att : rpass.rpci.attachments) {
+			hash_combine(key, att.format, att.samples);
+		}
+		for (auto& res : pass.pass.resources) {
+			if (is_framebuffer_attachment(res) && res.ia != eInputRead)
+				continue;
+			if (auto* att = impl->attachment_slots[res.id]) {
+				hash_combine(key, reinterpret_cast<uint64_t>(att->image), reinterpret_cast<uint64_t>(att->iv.payload));
+			} else if (auto* buf = impl->buffer_slots[res.id]) {
+				hash_combine(key, reinterpret_cast<uint64_t>(buf->buffer.buffer), buf->buffer.offset, buf->buffer.size);
+			}
+		}
+
+		return ptc.acquire_static_pass(pass.pass.name, *pass.pass.static_version, key, rpass.domain, [&](VkCommandBuffer scbuf, std::vector<DescriptorSet>& descriptor_sets) {
+			CommandBuffer cobuf(*this, ptc, scbuf);
+			// framebuffers are recreated with their attachments, so the recording doesn't name one
+			begin_secondary(scbuf, rpass, sp, cobuf, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT, VK_NULL_HANDLE);
+			cobuf.current_pass = &pass;
+			cobuf.static_descriptor_sets = &descriptor_sets;
+			if (pass.pass.execute) {
+				pass.pass.execute(cobuf);
+			}
+			vkEndCommandBuffer(scbuf);
+		});
+	}
+
+	void ExecutableRenderGraph::bind_resources(vuk::PerThreadContext& ptc, const std::vector<std::pair<SwapChainRef, size_t>>& swp_with_index) {
 		// create framebuffers, create & bind attachments
 		for (auto& rp : impl->rpis) {
 			if (rp.attachments.size() == 0)
@@ -126,7 +712,7 @@ namespace vuk {
 
 			// bind swapchain attachments, deduce framebuffer size & sample count
 			for (auto& attrpinfo : rp.attachments) {
-				auto& bound = impl->bound_attachments[attrpinfo.name];
+				auto& bound = *impl->attachment_slots[attrpinfo.id];
 
 				if (bound.type == AttachmentRPInfo::Type::eSwapchain) {
 					auto it = std::find_if(swp_with_index.begin(), swp_with_index.end(), [&](auto& t) { return t.first == bound.swapchain; });
@@ -149,7 +735,7 @@ namespace vuk {
 			}
 
 			for (auto& attrpinfo : rp.attachments) {
-				auto& bound = impl->bound_attachments[attrpinfo.name];
+				auto& bound = *impl->attachment_slots[attrpinfo.id];
 				if (extent_known) {
 					bound.extents = Dimension2D::absolute(fb_extent);
 				}
@@ -163,83 +749,211 @@ namespace vuk {
 				bound.image = it->first->images[it->second];
 			}
 		}
-	
+
+		// describe internal attachments, they are created together so that they can share memory
+		std::vector<std::pair<uint32_t, RGCI>> transients;
+		std::vector<bool> described(impl->resource_names.size());
 		for (auto& rp : impl->rpis) {
 			if (rp.attachments.size() == 0)
 				continue;
 
-			auto& ivs = rp.fbci.attachments;
-			std::vector<VkImageView> vkivs;
-
 			Extent2D fb_extent = Extent2D{rp.fbci.width, rp.fbci.height};
 			
 			// do a second pass so that we can infer from the attachments we previously inferred from
 			// TODO: we should allow arbitrary number of passes
 			if (fb_extent.width == 0 || fb_extent.height == 0) {
 				for (auto& attrpinfo : rp.attachments) {
-					auto& bound = impl->bound_attachments[attrpinfo.name];
+					auto& bound = *impl->attachment_slots[attrpinfo.id];
 					if (bound.extents.extent.width > 0 && bound.extents.extent.height > 0) {
 						fb_extent = bound.extents.extent;
 					}
 				}
 			}
 			// TODO: check here if all attachments have been sized
+			rp.fbci.width = fb_extent.width;
+			rp.fbci.height = fb_extent.height;
 
-			// create internal attachments; bind attachments to fb
 			for (auto& attrpinfo : rp.attachments) {
-				auto& bound = impl->bound_attachments[attrpinfo.name];
-				if (bound.type == AttachmentRPInfo::Type::eInternal) {
-					create_attachment(ptc, attrpinfo.name, bound, fb_extent, (vuk::SampleCountFlagBits)attrpinfo.description.samples);
+				auto& bound = *impl->attachment_slots[attrpinfo.id];
+				if (bound.type == AttachmentRPInfo::Type::eInternal && !described[attrpinfo.id]) {
+					described[attrpinfo.id] = true;
+					transients.emplace_back(attrpinfo.id, describe_attachment(attrpinfo.id, bound, fb_extent, (vuk::SampleCountFlagBits)attrpinfo.description.samples));
 				}
+			}
+		}
+
+		// describe non-attachment images
+		for (auto& [name, bound] : impl->bound_attachments) {
+			if (bound.type == AttachmentRPInfo::Type::eInternal && !described[bound.id]) {
+				described[bound.id] = true;
+				transients.emplace_back(bound.id, describe_attachment(bound.id, bound, vuk::Extent2D{0,0}, bound.samples.count));
+			}
+		}
+
+		if (transients.size() > 0) {
+			create_transients(ptc, transients);
+		}
+		create_transient_buffers(ptc);
 
+		// bind attachments to fb
+		for (auto& rp : impl->rpis) {
+			if (rp.attachments.size() == 0)
+				continue;
+
+			auto& ivs = rp.fbci.attachments;
+			std::vector<VkImageView> vkivs;
+
+			for (auto& attrpinfo : rp.attachments) {
+				auto& bound = *impl->attachment_slots[attrpinfo.id];
 				ivs.push_back(bound.iv);
 				vkivs.push_back(bound.iv.payload);
 			}
+			// dynamic rendering takes the views directly
+			if (rp.dynamic_rendering)
+				continue;
 			rp.fbci.renderPass = rp.handle;
 			rp.fbci.pAttachments = &vkivs[0];
-			rp.fbci.width = fb_extent.width;
-			rp.fbci.height = fb_extent.height;
 			rp.fbci.attachmentCount = (uint32_t)vkivs.size();
 			rp.fbci.layers = 1;
 			rp.framebuffer = ptc.acquire_framebuffer(rp.fbci);
 		}
 
-		// create non-attachment images
-		for (auto& [name, bound] : impl->bound_attachments) {
-			if (bound.type == AttachmentRPInfo::Type::eInternal && bound.image == VK_NULL_HANDLE) {
-				create_attachment(ptc, name, bound, vuk::Extent2D{0,0}, bound.samples.count);
+		impl->events.resize(impl->event_count);
+		for (auto& event : impl->events) {
+			event = ptc.acquire_event();
+		}
+
+		// views of the subranges passes use, the whole image uses the bound view
+		impl->subrange_views.clear();
+		for (uint32_t id = 0; id < impl->use_chains.size(); id++) {
+			auto bound = impl->attachment_slots[id];
+			if (!bound)
+				continue;
+			for (auto& ur : impl->use_chains[id]) {
+				if (ur.subrange == Resource::Subrange{})
+					continue;
+				auto it = std::find_if(impl->subrange_views.begin(), impl->subrange_views.end(), [&](auto& sv) { return sv.id == id && sv.subrange == ur.subrange; });
+				if (it != impl->subrange_views.end())
+					continue;
+				vuk::ImageViewCreateInfo ivci;
+				ivci.image = bound->image;
+				ivci.format = vuk::Format(bound->description.format);
+				ivci.viewType = ur.subrange.layer_count == 1 ? vuk::ImageViewType::e2D : vuk::ImageViewType::e2DArray;
+				ivci.subresourceRange = vuk::ImageSubresourceRange{ .aspectMask = format_to_aspect(ivci.format), .baseMipLevel = ur.subrange.base_level, .levelCount = ur.subrange.level_count, .baseArrayLayer = ur.subrange.base_layer, .layerCount = ur.subrange.layer_count };
+				impl->subrange_views.push_back(RGImpl::SubrangeView{ id, ur.subrange, ptc.create_image_view(ivci) });
 			}
 		}
+	}
+
+	VkCommandBuffer ExecutableRenderGraph::execute(vuk::PerThreadContext& ptc, std::vector<std::pair<SwapChainRef, size_t>> swp_with_index) {
+		bind_resources(ptc, swp_with_index);
+		auto profiler = begin_profiling(ptc, *impl);
+		impl->profiler = profiler ? &*profiler : nullptr;
 
 		// actual execution
-		auto cbuf = ptc.acquire_command_buffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		auto cbuf = submit_batches(ptc, [&](VkCommandBuffer cbuf, size_t rp_begin, size_t rp_end) {
+			record_renderpasses(ptc, cbuf, rp_begin, rp_end);
+		});
+		impl->profiler = nullptr;
+		return cbuf;
+	}
+
+	void ExecutableRenderGraph::enable_profiling(VkQueryPipelineStatisticFlags pipeline_statistics) {
+		impl->profiling = true;
+		impl->profiled_statistics = pipeline_statistics;
+	}
+
+	void ExecutableRenderGraph::split_submissions(size_t renderpasses, Submit submit) {
+		impl->renderpasses_per_submission = renderpasses;
+		impl->submit = std::move(submit);
+	}
 
-		VkCommandBufferBeginInfo cbi{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
-		vkBeginCommandBuffer(cbuf, &cbi);
+	void ExecutableRenderGraph::wait_for_swapchain(VkSemaphore semaphore, vuk::PipelineStageFlags stages) {
+		impl->swapchain_semaphore = semaphore;
+		impl->swapchain_wait_stages = stages;
+	}
+
+	// first renderpass using a swapchain image, SIZE_MAX if there is none
+	size_t first_swapchain_renderpass(const RGImpl& impl) {
+		size_t first = SIZE_MAX;
+		for (uint32_t id = 0; id < impl.use_chains.size(); id++) {
+			auto bound = impl.attachment_slots[id];
+			if (!bound || bound->type != AttachmentRPInfo::Type::eSwapchain)
+				continue;
+			for (auto& ur : impl.use_chains[id]) {
+				if (ur.pass)
+					first = std::min(first, ur.pass->render_pass_index);
+			}
+		}
+		return first;
+	}
+
+	// whether the renderpass starts with a dependency on earlier work, the GPU waits there regardless of a submission boundary
+	bool starts_with_barriers(const RenderPassInfo& rpass) {
+		if (rpass.aliasing_barriers.size() > 0)
+			return true;
+		if (rpass.subpasses.empty())
+			return false;
+		auto& sp = rpass.subpasses[0];
+		return sp.pre_barriers.size() > 0 || sp.pre_mem_barriers.size() > 0 || sp.wait_events.size() > 0;
+	}
 
+	// end of a chunk starting at rp_begin: at most chunk_size renderpasses, cut before the latest renderpass that waits on a barrier anyway
+	// if one is in the second half of the chunk, so that renderpasses that could overlap are kept in one submission
+	size_t chunk_end(const RGImpl& impl, size_t rp_begin, size_t chunk_size, size_t batch_end) {
+		size_t end = std::min(batch_end, rp_begin + chunk_size);
+		if (end == batch_end)
+			return end;
+		for (size_t rp = end; rp > rp_begin + (chunk_size + 1) / 2; rp--) {
+			if (starts_with_barriers(impl.rpis[rp]))
+				return rp;
+		}
+		return end;
+	}
+
+	void ExecutableRenderGraph::record_renderpasses(PerThreadContext& ptc, VkCommandBuffer cbuf, size_t rp_begin, size_t rp_end) {
 		CommandBuffer cobuf(*this, ptc, cbuf);
-		for (auto& rpass : impl->rpis) {
+		auto* profiler = impl->profiler;
+		for (size_t rp = rp_begin; rp < rp_end; rp++) {
+			auto& rpass = impl->rpis[rp];
+			auto rp_name = first_pass_name(rpass);
+			// pipeline statistics are only queried on the graphics queue
+			bool statistics = rpass.domain == Domain::eGraphics;
+			emit_barriers(ptc, cbuf, {}, rpass.aliasing_barriers, *impl, {}, rp_name);
+			if (profiler) {
+				profiler->record(profiler->rp_scopes[rp], GPUTiming::Kind::eRenderPass, rp_name);
+				profiler->begin(cbuf, profiler->rp_scopes[rp]);
+			}
             bool use_secondary_command_buffers = rpass.subpasses[0].use_secondary_command_buffers;
             begin_renderpass(rpass, cbuf, use_secondary_command_buffers);
 			for (size_t i = 0; i < rpass.subpasses.size(); i++) {
 				auto& sp = rpass.subpasses[i];
+				auto sp_name = sp.passes.size() > 0 ? sp.passes[0]->pass.name : Name{};
 				fill_renderpass_info(rpass, i, cobuf);
 				// insert image pre-barriers
 				if (rpass.handle == VK_NULL_HANDLE) {
-					for (auto dep : sp.pre_barriers) {
-						dep.barrier.image = impl->bound_attachments[dep.image].image;
-						vkCmdPipelineBarrier(cbuf, (VkPipelineStageFlags)dep.src, (VkPipelineStageFlags)dep.dst, 0, 0, nullptr, 0, nullptr, 1, &dep.barrier);
-					}
-					for (auto dep : sp.pre_mem_barriers) {
-						vkCmdPipelineBarrier(cbuf, (VkPipelineStageFlags)dep.src, (VkPipelineStageFlags)dep.dst, 0, 1, &dep.barrier, 0, nullptr, 0, nullptr);
-					}
+					wait_events(cbuf, sp.wait_events, *impl);
+					emit_barriers(ptc, cbuf, sp.pre_barriers, sp.pre_mem_barriers, *impl, {}, sp_name);
+				}
+				if (rpass.dynamic_rendering) {
+					begin_rendering(ptc, rpass, cbuf, use_secondary_command_buffers);
 				}
                 for(auto& p: sp.passes) {
+					auto pass_scope = profiler ? profiler->pass_scopes[p - impl->passes.data()] : 0;
+					if (p->pass.static_version) {
+						auto scbuf = acquire_static_pass(ptc, rpass, i, *p);
+						cobuf.execute({ &scbuf, 1 });
+						continue;
+					}
 					// if pass requested no secondary cbufs, but due to subpass merging that is what we got
 					if (p->pass.use_secondary_command_buffers == false && use_secondary_command_buffers == true) {
                         auto secondary = cobuf.begin_secondary();
                         if(p->pass.execute) {
                             secondary.current_pass = p;
+							if (profiler) {
+								profiler->record(pass_scope, GPUTiming::Kind::ePass, p->pass.name);
+								profiler->begin(secondary.command_buffer, pass_scope, statistics);
+							}
                             if(!p->pass.name.empty()) {
                                 //ptc.ctx.debug.begin_region(cobuf.command_buffer, sp.pass->pass.name);
                                 p->pass.execute(secondary);
@@ -247,12 +961,21 @@ namespace vuk {
                             } else {
                                 p->pass.execute(secondary);
                             }
+							if (profiler) {
+								profiler->end(secondary.command_buffer, pass_scope, statistics);
+							}
                         }
                         auto result = secondary.get_buffer();
                         cobuf.execute({&result, 1});
                     } else {
+						// a pass executing its own secondaries leaves no room for commands in the primary, it is only covered by its renderpass
+						bool profile_pass = profiler && !use_secondary_command_buffers;
                         if(p->pass.execute) {
                             cobuf.current_pass = p;
+							if (profile_pass) {
+								profiler->record(pass_scope, GPUTiming::Kind::ePass, p->pass.name);
+								profiler->begin(cbuf, pass_scope, statistics);
+							}
                             if(!p->pass.name.empty()) {
                                 //ptc.ctx.debug.begin_region(cobuf.command_buffer, sp.pass->pass.name);
                                 p->pass.execute(cobuf);
@@ -260,6 +983,9 @@ namespace vuk {
                             } else {
                                 p->pass.execute(cobuf);
                             }
+							if (profile_pass) {
+								profiler->end(cbuf, pass_scope, statistics);
+							}
                         }
 
                         cobuf.attribute_descriptions.clear();
@@ -273,22 +999,241 @@ namespace vuk {
 					vkCmdNextSubpass(cbuf, use_secondary_command_buffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 				}
 
+				if (rpass.dynamic_rendering) {
+					ptc.ctx.cmdEndRenderingKHR(cbuf);
+				}
 				// insert image post-barriers
 				if (rpass.handle == VK_NULL_HANDLE) {
-					for (auto dep : sp.post_barriers) {
-						dep.barrier.image = impl->bound_attachments[dep.image].image;
-						vkCmdPipelineBarrier(cbuf, (VkPipelineStageFlags)dep.src, (VkPipelineStageFlags)dep.dst, 0, 0, nullptr, 0, nullptr, 1, &dep.barrier);
-					}
-					for (auto dep : sp.post_mem_barriers) {
-						vkCmdPipelineBarrier(cbuf, (VkPipelineStageFlags)dep.src, (VkPipelineStageFlags)dep.dst, 0, 1, &dep.barrier, 0, nullptr, 0, nullptr);
-					}
+					emit_barriers(ptc, cbuf, sp.post_barriers, sp.post_mem_barriers, *impl, {}, sp_name);
+					set_events(cbuf, sp.set_events, *impl);
 				}
 			}
 			if (rpass.handle != VK_NULL_HANDLE) {
 				vkCmdEndRenderPass(cbuf);
 			}
+			if (profiler) {
+				profiler->end(cbuf, profiler->rp_scopes[rp]);
+			}
+		}
+	}
+
+	VkCommandBuffer ExecutableRenderGraph::submit_batches(PerThreadContext& ptc, const std::function<void(VkCommandBuffer, size_t rp_begin, size_t rp_end)>& record) {
+		auto& batches = impl->batches;
+		// a semaphore for every wait between batches
+		std::vector<std::vector<VkSemaphore>> signals(batches.size());
+		std::vector<std::vector<VkSemaphore>> waits(batches.size());
+		std::vector<std::vector<VkPipelineStageFlags>> wait_stages(batches.size());
+		for (size_t i = 0; i < batches.size(); i++) {
+			for (auto& [src, stages] : batches[i].waits) {
+				auto sema = ptc.acquire_semaphore();
+				signals[src].push_back(sema);
+				waits[i].push_back(sema);
+				wait_stages[i].push_back((VkPipelineStageFlags)stages);
+			}
+		}
+
+		auto submit = [&](Domain domain, const VkSubmitInfo& si) {
+			if (impl->submit) {
+				impl->submit(domain, si);
+			} else if (domain == Domain::eCompute) {
+				ptc.ctx.submit_compute(si, VK_NULL_HANDLE);
+			} else {
+				ptc.ctx.submit_graphics(si, VK_NULL_HANDLE);
+			}
+		};
+
+		// chunks submitted here would otherwise run before the swapchain image is acquired: the acquire is waited on by the chunk using the image first
+		// (or, if none does, ahead of the returned command buffer)
+		auto swapchain_rp = first_swapchain_renderpass(*impl);
+		bool swapchain_wait_pending = impl->swapchain_semaphore != VK_NULL_HANDLE;
+
+		VkCommandBuffer cbuf = VK_NULL_HANDLE;
+		for (size_t i = 0; i < batches.size(); i++) {
+			auto& batch = batches[i];
+			// chunks of a batch follow each other on the same queue, so they only need the batch's semaphores at its ends
+			auto chunk_size = impl->renderpasses_per_submission > 0 ? impl->renderpasses_per_submission : batch.rp_end - batch.rp_begin;
+			size_t rp_begin = batch.rp_begin;
+			do {
+				size_t rp_end = chunk_end(*impl, rp_begin, std::max(chunk_size, size_t(1)), batch.rp_end);
+				bool first = rp_begin == batch.rp_begin;
+				bool last = rp_end == batch.rp_end;
+				bool returned = i == batches.size() - 1 && last;
+				cbuf = ptc.acquire_command_buffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, batch.domain);
+
+				VkCommandBufferBeginInfo cbi{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+				vkBeginCommandBuffer(cbuf, &cbi);
+				if (first) {
+					if (impl->profiler) {
+						impl->profiler->reset(cbuf, i);
+					}
+					emit_barriers(ptc, cbuf, batch.acquire_barriers, {}, *impl, batch.acquire_buffer_barriers, "queue acquire");
+				}
+				record(cbuf, rp_begin, rp_end);
+				if (last) {
+					emit_barriers(ptc, cbuf, batch.release_barriers, {}, *impl, batch.release_buffer_barriers, "queue release");
+				}
+				vkEndCommandBuffer(cbuf);
+
+				VkSubmitInfo si{ .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO };
+				std::vector<VkSemaphore> chunk_waits;
+				std::vector<VkPipelineStageFlags> chunk_wait_stages;
+				if (first) {
+					chunk_waits = waits[i];
+					chunk_wait_stages = wait_stages[i];
+				}
+				if (swapchain_wait_pending && ((rp_begin <= swapchain_rp && swapchain_rp < rp_end) || returned)) {
+					swapchain_wait_pending = false;
+					chunk_waits.push_back(impl->swapchain_semaphore);
+					chunk_wait_stages.push_back((VkPipelineStageFlags)impl->swapchain_wait_stages);
+				}
+				si.waitSemaphoreCount = (uint32_t)chunk_waits.size();
+				si.pWaitSemaphores = chunk_waits.data();
+				si.pWaitDstStageMask = chunk_wait_stages.data();
+				// the last chunk is submitted by the caller, so its waits go into a submission ahead of it
+				// (a wait also orders everything submitted later to the queue)
+				if (returned) {
+					if (si.waitSemaphoreCount > 0) {
+						submit(batch.domain, si);
+					}
+					break;
+				}
+				si.commandBufferCount = 1;
+				si.pCommandBuffers = &cbuf;
+				if (last) {
+					si.signalSemaphoreCount = (uint32_t)signals[i].size();
+					si.pSignalSemaphores = signals[i].data();
+				}
+				submit(batch.domain, si);
+				rp_begin = rp_end;
+			} while (rp_begin < batch.rp_end);
+		}
+		return cbuf;
+	}
+
+	VkCommandBuffer ExecutableRenderGraph::execute(vuk::PerThreadContext& ptc, std::vector<std::pair<SwapChainRef, size_t>> swp_with_index, const ParallelFor& parallel_for) {
+		bind_resources(ptc, swp_with_index);
+
+		// every pass is recorded into its own secondary cbuf, except passes executing their own secondaries
+		struct Job {
+			size_t rp;
+			size_t sp;
+			PassInfo* pass;
+		};
+		std::vector<Job> jobs;
+		std::vector<size_t> rp_first_job(impl->rpis.size());
+		for (size_t rp = 0; rp < impl->rpis.size(); rp++) {
+			rp_first_job[rp] = jobs.size();
+			auto& rpass = impl->rpis[rp];
+			for (size_t sp = 0; sp < rpass.subpasses.size(); sp++) {
+				for (auto& p : rpass.subpasses[sp].passes) {
+					jobs.push_back(Job{ rp, sp, p });
+				}
+			}
 		}
-		vkEndCommandBuffer(cbuf);
+
+		auto profiler = begin_profiling(ptc, *impl);
+		impl->profiler = profiler ? &*profiler : nullptr;
+
+		std::vector<VkCommandBuffer> secondaries(jobs.size(), VK_NULL_HANDLE);
+		parallel_for(jobs.size(), [&](PerThreadContext& wptc, size_t i) {
+			auto& job = jobs[i];
+			if (!job.pass->pass.execute)
+				return;
+			auto& rpass = impl->rpis[job.rp];
+
+			if (job.pass->pass.static_version) {
+				secondaries[i] = acquire_static_pass(wptc, rpass, job.sp, *job.pass);
+				return;
+			}
+			// a pass executing its own secondaries can't be recorded into one, it is executed when stitching
+			if (job.pass->pass.use_secondary_command_buffers) {
+				return;
+			}
+
+			auto scbuf = wptc.acquire_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY, rpass.domain);
+			CommandBuffer cobuf(*this, wptc, scbuf);
+			begin_secondary(scbuf, rpass, job.sp, cobuf, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, rpass.framebuffer);
+
+			cobuf.current_pass = job.pass;
+			if (profiler) {
+				profiler->begin(scbuf, profiler->pass_scopes[job.pass - impl->passes.data()], rpass.domain == Domain::eGraphics);
+			}
+			job.pass->pass.execute(cobuf);
+			if (profiler) {
+				profiler->end(scbuf, profiler->pass_scopes[job.pass - impl->passes.data()], rpass.domain == Domain::eGraphics);
+			}
+
+			vkEndCommandBuffer(scbuf);
+			secondaries[i] = scbuf;
+		});
+
+		// stitch the secondaries together in submission order
+		auto cbuf = submit_batches(ptc, [&](VkCommandBuffer cbuf, size_t rp_begin, size_t rp_end) {
+			CommandBuffer cobuf(*this, ptc, cbuf);
+			size_t job_index = rp_begin < rp_first_job.size() ? rp_first_job[rp_begin] : jobs.size();
+			for (size_t rp = rp_begin; rp < rp_end; rp++) {
+				auto& rpass = impl->rpis[rp];
+				auto rp_name = first_pass_name(rpass);
+				emit_barriers(ptc, cbuf, {}, rpass.aliasing_barriers, *impl, {}, rp_name);
+				if (profiler) {
+					profiler->record(profiler->rp_scopes[rp], GPUTiming::Kind::eRenderPass, rp_name);
+					profiler->begin(cbuf, profiler->rp_scopes[rp]);
+				}
+				begin_renderpass(rpass, cbuf, true);
+				for (size_t i = 0; i < rpass.subpasses.size(); i++) {
+					auto& sp = rpass.subpasses[i];
+					auto sp_name = sp.passes.size() > 0 ? sp.passes[0]->pass.name : Name{};
+					if (rpass.handle == VK_NULL_HANDLE) {
+						wait_events(cbuf, sp.wait_events, *impl);
+						emit_barriers(ptc, cbuf, sp.pre_barriers, sp.pre_mem_barriers, *impl, {}, sp_name);
+					}
+					if (rpass.dynamic_rendering) {
+						begin_rendering(ptc, rpass, cbuf, true);
+					}
+					fill_renderpass_info(rpass, i, cobuf);
+					std::vector<VkCommandBuffer> recorded;
+					for (size_t j = 0; j < sp.passes.size(); j++, job_index++) {
+						auto* p = jobs[job_index].pass;
+						if (p->pass.execute && !p->pass.static_version && p->pass.use_secondary_command_buffers) {
+							// keep the order of the secondaries: flush the ones before, then let the pass execute its own into the primary
+							if (recorded.size() > 0) {
+								vkCmdExecuteCommands(cbuf, (uint32_t)recorded.size(), recorded.data());
+								recorded.clear();
+							}
+							cobuf.current_pass = p;
+							p->pass.execute(cobuf);
+							continue;
+						}
+						if (secondaries[job_index] != VK_NULL_HANDLE) {
+							recorded.push_back(secondaries[job_index]);
+							if (profiler && !p->pass.static_version) {
+								profiler->record(profiler->pass_scopes[p - impl->passes.data()], GPUTiming::Kind::ePass, p->pass.name);
+							}
+						}
+					}
+					if (recorded.size() > 0) {
+						vkCmdExecuteCommands(cbuf, (uint32_t)recorded.size(), recorded.data());
+					}
+					if (i < rpass.subpasses.size() - 1 && rpass.handle != VK_NULL_HANDLE) {
+						vkCmdNextSubpass(cbuf, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					}
+					if (rpass.dynamic_rendering) {
+						ptc.ctx.cmdEndRenderingKHR(cbuf);
+					}
+					if (rpass.handle == VK_NULL_HANDLE) {
+						emit_barriers(ptc, cbuf, sp.post_barriers, sp.post_mem_barriers, *impl, {}, sp_name);
+						set_events(cbuf, sp.set_events, *impl);
+					}
+				}
+				if (rpass.handle != VK_NULL_HANDLE) {
+					vkCmdEndRenderPass(cbuf);
+				}
+				if (profiler) {
+					profiler->end(cbuf, profiler->rp_scopes[rp]);
+				}
+			}
+		});
+		impl->profiler = nullptr;
 		return cbuf;
 	}
 	
@@ -300,8 +1245,17 @@ namespace vuk {
 		return impl->bound_attachments.at(n);
 	}
 
+	vuk::ImageView ExecutableRenderGraph::get_resource_image_view(Name n, const Resource::Subrange& subrange) {
+		auto id = impl->resource_ids.at(n);
+		if (subrange == Resource::Subrange{})
+			return impl->attachment_slots[id]->iv;
+		auto it = std::find_if(impl->subrange_views.begin(), impl->subrange_views.end(), [&](auto& sv) { return sv.id == id && sv.subrange == subrange; });
+		assert(it != impl->subrange_views.end() && "views are only created for the subranges passes use");
+		return *it->view;
+	}
+
 	bool ExecutableRenderGraph::is_resource_image_in_general_layout(Name n, PassInfo* pass_info) {
-		auto& chain = impl->use_chains.at(n);
+		auto& chain = impl->use_chains[impl->resource_ids.at(n)];
 		for (auto& elem : chain) {
 			if (elem.pass == pass_info) {
 				return elem.use.layout == vuk::ImageLayout::eGeneral;
@@ -535,4 +535,54 @@ namespace vuk {
 		return extent_in_blocks.width * extent_in_blocks.height * extent_in_blocks.depth * format_to_texel_block_size(format);
 	}
 
+	bool format_is_integer(vuk::Format format) noexcept {
+		switch (format) {
+		case vuk::Format::eA2B10G10R10SintPack32:
+		case vuk::Format::eA2B10G10R10UintPack32:
+		case vuk::Format::eA2R10G10B10SintPack32:
+		case vuk::Format::eA2R10G10B10UintPack32:
+		case vuk::Format::eA8B8G8R8SintPack32:
+		case vuk::Format::eA8B8G8R8UintPack32:
+		case vuk::Format::eB8G8R8A8Sint:
+		case vuk::Format::eB8G8R8A8Uint:
+		case vuk::Format::eB8G8R8Sint:
+		case vuk::Format::eB8G8R8Uint:
+		case vuk::Format::eR16G16B16A16Sint:
+		case vuk::Format::eR16G16B16A16Uint:
+		case vuk::Format::eR16G16B16Sint:
+		case vuk::Format::eR16G16B16Uint:
+		case vuk::Format::eR16G16Sint:
+		case vuk::Format::eR16G16Uint:
+		case vuk::Format::eR16Sint:
+		case vuk::Format::eR16Uint:
+		case vuk::Format::eR32G32B32A32Sint:
+		case vuk::Format::eR32G32B32A32Uint:
+		case vuk::Format::eR32G32B32Sint:
+		case vuk::Format::eR32G32B32Uint:
+		case vuk::Format::eR32G32Sint:
+		case vuk::Format::eR32G32Uint:
+		case vuk::Format::eR32Sint:
+		case vuk::Format::eR32Uint:
+		case vuk::Format::eR64G64B64A64Sint:
+		case vuk::Format::eR64G64B64A64Uint:
+		case vuk::Format::eR64G64B64Sint:
+		case vuk::Format::eR64G64B64Uint:
+		case vuk::Format::eR64G64Sint:
+		case vuk::Format::eR64G64Uint:
+		case vuk::Format::eR64Sint:
+		case vuk::Format::eR64Uint:
+		case vuk::Format::eR8G8B8A8Sint:
+		case vuk::Format::eR8G8B8A8Uint:
+		case vuk::Format::eR8G8B8Sint:
+		case vuk::Format::eR8G8B8Uint:
+		case vuk::Format::eR8G8Sint:
+		case vuk::Format::eR8G8Uint:
+		case vuk::Format::eR8Sint:
+		case vuk::Format::eR8Uint:
+			return true;
+		default:
+			return false;
+		}
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "vuk/ShortAlloc.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef VUK_COUNT_HEAP_ALLOCATIONS
+namespace {
+	thread_local std::size_t heap_allocations = 0;
+
+	void* counted_alloc(std::size_t n) {
+		heap_allocations++;
+		if (auto p = std::malloc(n == 0 ? 1 : n))
+			return p;
+		throw std::bad_alloc();
+	}
+
+	void* counted_aligned_alloc(std::size_t n, std::align_val_t al) {
+		heap_allocations++;
+		auto align = std::max((std::size_t)al, sizeof(void*));
+		n = (std::max(n, (std::size_t)1) + align - 1) & ~(align - 1);
+#ifdef _WIN32
+		auto p = _aligned_malloc(n, align);
+#else
+		auto p = std::aligned_alloc(align, n);
+#endif
+		if (p)
+			return p;
+		throw std::bad_alloc();
+	}
+
+	void aligned_free(void* p) noexcept {
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+// the nothrow and array forms without their own replacement call these
+void* operator new(std::size_t n) {
+	return counted_alloc(n);
+}
+void* operator new[](std::size_t n) {
+	return counted_alloc(n);
+}
+void* operator new(std::size_t n, std::align_val_t al) {
+	return counted_aligned_alloc(n, al);
+}
+void* operator new[](std::size_t n, std::align_val_t al) {
+	return counted_aligned_alloc(n, al);
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+	aligned_free(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+	aligned_free(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	aligned_free(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+	aligned_free(p);
+}
+
+std::size_t vuk::thread_heap_allocations() noexcept {
+	return heap_allocations;
+}
+#else
+std::size_t vuk::thread_heap_allocations() noexcept {
+	return 0;
+}
+#endif
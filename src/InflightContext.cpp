@@ -1,6 +1,9 @@
 #include "vuk/Context.hpp"
 #include "ContextImpl.hpp"
 #include "Pool.hpp"
+#include <algorithm>
+#include <bit>
+#include <iterator>
 
 vuk::InflightContext::InflightContext(Context& ctx, size_t absolute_frame, std::lock_guard<std::mutex>&& recycle_guard) :
 	ctx(ctx),
@@ -38,10 +41,77 @@ vuk::InflightContext::InflightContext(Context& ctx, size_t absolute_frame, std::
 		ctx.impl->allocator.reset_pool(v.value);
 	}
 
+	// profiled executions of this frame have completed (their fences were waited on above), so their queries are read back without waiting
+	{
+		std::lock_guard _(ctx.impl->queries_lock);
+		auto& fq = ctx.impl->frame_queries[frame];
+		if (fq.executions.size() > 0) {
+			std::vector<GPUTiming> timings;
+			std::vector<uint64_t> stamps;
+			std::vector<uint64_t> stats;
+			for (auto& ex : fq.executions) {
+				// [value, availability] pairs, scopes that were not recorded or submitted stay unavailable
+				stamps.resize(4 * ex.scope_count);
+				vkGetQueryPoolResults(ctx.device, ex.timestamps, 0, 2 * ex.scope_count, stamps.size() * sizeof(uint64_t), stamps.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+				auto stat_count = (size_t)std::popcount(ex.statistics_flags);
+				if (ex.statistics != VK_NULL_HANDLE) {
+					stats.resize((stat_count + 1) * ex.scope_count);
+					vkGetQueryPoolResults(ctx.device, ex.statistics, 0, ex.scope_count, stats.size() * sizeof(uint64_t), stats.data(), (stat_count + 1) * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+				}
+				for (auto& scope : ex.scopes) {
+					auto* begin = &stamps[4 * scope.index];
+					if (begin[1] == 0 || begin[3] == 0)
+						continue;
+					auto& t = timings.emplace_back(GPUTiming{ .kind = scope.kind, .name = scope.name });
+					t.ms = (begin[2] - begin[0]) * (double)ctx.timestamp_period / 1e6;
+					if (ex.statistics != VK_NULL_HANDLE && scope.kind == GPUTiming::Kind::ePass) {
+						auto* s = &stats[(stat_count + 1) * scope.index];
+						if (s[stat_count] != 0) {
+							t.pipeline_statistics.assign(s, s + stat_count);
+						}
+					}
+				}
+			}
+			ctx.impl->gpu_timings = std::move(timings);
+			fq.executions.clear();
+		}
+	}
+
 	auto ptc = begin();
+	{
+		std::lock_guard _(ctx.impl->static_passes_lock);
+		for (auto& sp : ctx.impl->static_pass_recycle[frame]) {
+			vkFreeCommandBuffers(ctx.device, ctx.impl->static_pass_pools[(size_t)sp.domain], 1, &sp.command_buffer);
+			for (auto& ds : sp.descriptor_sets) {
+				ptc.destroy(ds);
+			}
+		}
+		ctx.impl->static_pass_recycle[frame].clear();
+		// recordings of keys that stopped appearing (e.g. resources of a resized or removed graph) are released like other caches
+		for (auto it = ctx.impl->static_passes.begin(); it != ctx.impl->static_passes.end();) {
+			auto& recordings = it->second;
+			auto unused = std::partition(recordings.begin(), recordings.end(), [&](auto& sp) { return sp.last_use + Context::FC * 2 > absolute_frame; });
+			auto& recycle = ctx.impl->static_pass_recycle[frame];
+			recycle.insert(recycle.end(), std::make_move_iterator(unused), std::make_move_iterator(recordings.end()));
+			recordings.erase(unused, recordings.end());
+			it = recordings.empty() ? ctx.impl->static_passes.erase(it) : std::next(it);
+		}
+	}
 	ptc.impl->descriptor_sets.collect(Context::FC * 2);
 	ptc.impl->transient_images.collect(Context::FC * 2);
+	ptc.impl->transient_heaps.collect(Context::FC * 2);
+	ptc.impl->transient_buffers.collect(Context::FC * 2);
 	ptc.impl->scratch_buffers.collect(Context::FC * 2);
+	{
+		std::lock_guard _(ctx.impl->compiled_rgs_lock);
+		for (auto it = ctx.impl->compiled_rgs.begin(); it != ctx.impl->compiled_rgs.end();) {
+			if (absolute_frame - it->second->last_use_frame > Context::FC * 2) {
+				it = ctx.impl->compiled_rgs.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
 }
 
 vuk::InflightContext::~InflightContext() {
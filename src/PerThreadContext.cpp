@@ -1,5 +1,7 @@
 #include "vuk/Context.hpp"
 #include "ContextImpl.hpp"
+#include <algorithm>
+#include <iterator>
 
 vuk::PerThreadContext::PerThreadContext(InflightContext& ifc, unsigned tid) : ctx(ifc.ctx), ifc(ifc), tid(tid), impl(new PTCImpl(ifc, *this)) {
 }
@@ -78,6 +80,7 @@ vuk::Unique<vuk::PersistentDescriptorSet> vuk::PerThreadContext::create_persiste
 }
 
 void vuk::PerThreadContext::commit_persistent_descriptorset(vuk::PersistentDescriptorSet& array) {
+	// persistent updates are sparse array elements, a template would have to be created for each pattern, costing more than these writes
 	vkUpdateDescriptorSets(ctx.device, (uint32_t)array.pending_writes.size(), array.pending_writes.data(), 0, nullptr);
 	array.pending_writes.clear();
 }
@@ -190,35 +193,16 @@ vuk::SampledImage& vuk::PerThreadContext::make_sampled_image(Name n, vuk::ImageV
 vuk::DescriptorSet vuk::PerThreadContext::create(const create_info_t<vuk::DescriptorSet>& cinfo) {
 	auto& pool = impl->pool_cache.acquire(cinfo.layout_info);
 	auto ds = pool.acquire(*this, cinfo.layout_info);
-	auto mask = cinfo.used.to_ulong();
-	unsigned long leading_ones = num_leading_ones(mask);
-	std::array<VkWriteDescriptorSet, VUK_MAX_BINDINGS> writes;
-	for (unsigned i = 0; i < leading_ones; i++) {
-		if (!cinfo.used.test(i)) continue;
-		auto& write = writes[i];
-		write = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-		auto& binding = cinfo.bindings[i];
-		write.descriptorType = (VkDescriptorType)binding.type;
-		write.dstArrayElement = 0;
-		write.descriptorCount = 1;
-		write.dstBinding = i;
-		write.dstSet = ds;
-		switch (binding.type) {
-		case vuk::DescriptorType::eUniformBuffer:
-		case vuk::DescriptorType::eStorageBuffer:
-			write.pBufferInfo = &binding.buffer;
-			break;
-		case vuk::DescriptorType::eSampledImage:
-		case vuk::DescriptorType::eSampler:
-		case vuk::DescriptorType::eCombinedImageSampler:
-		case vuk::DescriptorType::eStorageImage:
-			write.pImageInfo = &binding.image.dii;
-			break;
-		default:
-			assert(0);
-		}
+	// every binding of the layout is written: one template update from the packed infos
+	if (cinfo.layout_info.update_template != VK_NULL_HANDLE && cinfo.used.to_ulong() == cinfo.layout_info.template_mask) {
+		std::array<DescriptorUpdateSlot, VUK_MAX_BINDINGS> slots;
+		cinfo.fill_update_slots(slots);
+		vkUpdateDescriptorSetWithTemplate(ctx.device, ds, cinfo.layout_info.update_template, slots.data());
+		return { ds, cinfo.layout_info };
 	}
-	vkUpdateDescriptorSets(ctx.device, leading_ones, writes.data(), 0, nullptr);
+	std::array<VkWriteDescriptorSet, VUK_MAX_BINDINGS> writes;
+	auto count = cinfo.fill_writes(writes, ds);
+	vkUpdateDescriptorSets(ctx.device, count, writes.data(), 0, nullptr);
 	return { ds, cinfo.layout_info };
 }
 
@@ -226,9 +210,7 @@ vuk::LinearAllocator vuk::PerThreadContext::create(const create_info_t<vuk::Line
 	return ctx.impl->allocator.allocate_linear(cinfo.mem_usage, cinfo.buffer_usage);
 }
 
-vuk::RGImage vuk::PerThreadContext::create(const create_info_t<vuk::RGImage>& cinfo) {
-	RGImage res{};
-	res.image = ctx.impl->allocator.create_image_for_rendertarget(cinfo.ici);
+static void create_rendertarget_view(vuk::Context& ctx, vuk::RGImage& res, const vuk::RGCI& cinfo) {
 	auto ivci = cinfo.ivci;
 	ivci.image = res.image;
 	std::string name = std::string("Image: RenderTarget ") + std::string(cinfo.name);
@@ -241,6 +223,88 @@ vuk::RGImage vuk::PerThreadContext::create(const create_info_t<vuk::RGImage>& ci
 		res.image_view = ctx.wrap(iv);
 		ctx.debug.set_name(res.image_view.payload, name);
 	}
+}
+
+vuk::RGImage vuk::PerThreadContext::create(const create_info_t<vuk::RGImage>& cinfo) {
+	RGImage res{};
+	res.image = ctx.impl->allocator.create_image_for_rendertarget(cinfo.ici);
+	create_rendertarget_view(ctx, res, cinfo);
+	return res;
+}
+
+vuk::TransientHeap vuk::PerThreadContext::create(const create_info_t<vuk::TransientHeap>& cinfo) {
+	TransientHeap res;
+	auto count = cinfo.images.size();
+	std::vector<VkMemoryRequirements> reqs(count);
+	for (size_t i = 0; i < count; i++) {
+		VkImageCreateInfo vkici = cinfo.images[i].ici;
+		VkImage vkimg;
+		vkCreateImage(ctx.device, &vkici, nullptr, &vkimg);
+		vkGetImageMemoryRequirements(ctx.device, vkimg, &reqs[i]);
+		res.images.push_back(RGImage{ .image = vkimg });
+	}
+
+	// images can only share a block if they agree on the memory types, and on wanting lazily allocated memory
+	std::vector<std::pair<uint32_t, bool>> block_types;
+	res.blocks.resize(count);
+	res.offsets.resize(count);
+	res.sizes.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		std::pair<uint32_t, bool> type{ reqs[i].memoryTypeBits, (bool)(cinfo.images[i].ici.usage & vuk::ImageUsageFlagBits::eTransientAttachment) };
+		auto it = std::find(block_types.begin(), block_types.end(), type);
+		if (it == block_types.end()) {
+			it = block_types.insert(block_types.end(), type);
+		}
+		res.blocks[i] = (uint32_t)std::distance(block_types.begin(), it);
+		res.sizes[i] = reqs[i].size;
+	}
+
+	for (uint32_t b = 0; b < block_types.size(); b++) {
+		std::vector<VkMemoryRequirements> block_reqs;
+		std::vector<std::pair<uint32_t, uint32_t>> block_lifetimes;
+		std::vector<size_t> block_images;
+		for (size_t i = 0; i < count; i++) {
+			if (res.blocks[i] != b)
+				continue;
+			block_reqs.push_back(reqs[i]);
+			block_lifetimes.push_back(cinfo.lifetimes[i]);
+			block_images.push_back(i);
+		}
+		std::vector<VkDeviceSize> block_offsets(block_images.size());
+		VkMemoryRequirements mem_reqs{};
+		mem_reqs.size = place_aliased(block_reqs, block_lifetimes, block_offsets);
+		mem_reqs.memoryTypeBits = block_types[b].first;
+		for (auto& r : block_reqs) {
+			mem_reqs.alignment = std::max(mem_reqs.alignment, r.alignment);
+		}
+		res.memory.push_back(ctx.impl->allocator.allocate_image_memory(mem_reqs, block_types[b].second));
+		for (size_t k = 0; k < block_images.size(); k++) {
+			res.offsets[block_images[k]] = block_offsets[k];
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		ctx.impl->allocator.bind_image_memory(res.images[i].image, res.memory[res.blocks[i]], res.offsets[i]);
+		create_rendertarget_view(ctx, res.images[i], cinfo.images[i]);
+	}
+	return res;
+}
+
+vuk::TransientBuffers vuk::PerThreadContext::create(const create_info_t<vuk::TransientBuffers>& cinfo) {
+	TransientBuffers res;
+	// every buffer can be bound at offset 0 as a uniform, storage or texel buffer
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(ctx.physical_device, &properties);
+	auto& limits = properties.limits;
+	VkDeviceSize alignment = std::max({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, limits.minTexelBufferOffsetAlignment });
+	std::vector<VkMemoryRequirements> reqs(cinfo.sizes.size());
+	for (size_t i = 0; i < cinfo.sizes.size(); i++) {
+		reqs[i].size = cinfo.sizes[i];
+		reqs[i].alignment = alignment;
+	}
+	res.offsets.resize(cinfo.sizes.size());
+	auto size = place_aliased(reqs, cinfo.lifetimes, res.offsets);
+	res.buffer = ctx.impl->allocator.allocate_buffer(MemoryUsage::eGPUonly, cinfo.usage, size, alignment, false);
 	return res;
 }
 
@@ -264,11 +328,20 @@ vuk::PipelineInfo vuk::PerThreadContext::create(const create_info_t<PipelineInfo
 	gpci.layout = cinfo.base->pipeline_layout;
 	gpci.pStages = cinfo.base->psscis.data();
 	gpci.stageCount = (uint32_t)cinfo.base->psscis.size();
+	// without a renderpass, the attachment formats come from the dynamic rendering the pipeline is used in
+	VkPipelineRenderingCreateInfoKHR prci{ .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR };
+	if (gpci.renderPass == VK_NULL_HANDLE) {
+		prci.colorAttachmentCount = (uint32_t)cinfo.color_formats.size();
+		prci.pColorAttachmentFormats = cinfo.color_formats.data();
+		prci.depthAttachmentFormat = cinfo.depth_format;
+		prci.stencilAttachmentFormat = cinfo.stencil_format;
+		gpci.pNext = &prci;
+	}
 
 	VkPipeline pipeline;
 	vkCreateGraphicsPipelines(ctx.device, ctx.impl->vk_pipeline_cache, 1, &gpci, nullptr, &pipeline);
 	ctx.debug.set_name(pipeline, cinfo.base->pipeline_name);
-	return { pipeline, gpci.layout, cinfo.base->layout_info };
+	return { pipeline, gpci.layout, cinfo.base->layout_info, std::hash<std::vector<VkPushConstantRange>>()(cinfo.base->reflection_info.push_constant_ranges) };
 }
 
 vuk::ComputePipelineInfo vuk::PerThreadContext::create(const create_info_t<ComputePipelineInfo>& cinfo) {
@@ -308,14 +381,51 @@ VkFence vuk::PerThreadContext::acquire_fence() {
 	return impl->fence_pool.acquire(1)[0];
 }
 
-VkCommandBuffer vuk::PerThreadContext::acquire_command_buffer(VkCommandBufferLevel level) {
-	return impl->commandbuffer_pool.acquire(level, 1)[0];
+VkCommandBuffer vuk::PerThreadContext::acquire_command_buffer(VkCommandBufferLevel level, Domain domain) {
+	return impl->commandbuffer_pool.acquire(level, 1, domain)[0];
 }
 
 VkSemaphore vuk::PerThreadContext::acquire_semaphore() {
 	return impl->semaphore_pool.acquire(1)[0];
 }
 
+VkEvent vuk::PerThreadContext::acquire_event() {
+	return impl->event_pool.acquire(1)[0];
+}
+
+vuk::ProfiledExecution& vuk::PerThreadContext::acquire_profiled_execution(uint32_t scope_count, VkQueryPipelineStatisticFlags pipeline_statistics) {
+	std::lock_guard _(ctx.impl->queries_lock);
+	auto& fq = ctx.impl->frame_queries[ifc.frame];
+	auto index = fq.executions.size();
+	if (fq.timestamp_pools.size() <= index) {
+		fq.timestamp_pools.resize(index + 1);
+		fq.statistics_pools.resize(index + 1);
+	}
+	// the previous user of the slot was read back when this frame began, so a pool too small can be replaced
+	auto fit = [&](ContextImpl::QueryPoolSlot& slot, VkQueryType type, uint32_t count, VkQueryPipelineStatisticFlags statistics) {
+		if (slot.pool != VK_NULL_HANDLE && slot.count >= count && slot.statistics == statistics)
+			return slot.pool;
+		vkDestroyQueryPool(ctx.device, slot.pool, nullptr);
+		VkQueryPoolCreateInfo qpci{ .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		qpci.queryType = type;
+		qpci.queryCount = std::max(count, slot.count);
+		qpci.pipelineStatistics = statistics;
+		vkCreateQueryPool(ctx.device, &qpci, nullptr, &slot.pool);
+		slot.count = qpci.queryCount;
+		slot.statistics = statistics;
+		return slot.pool;
+	};
+
+	auto& ex = fq.executions.emplace_back();
+	ex.scope_count = scope_count;
+	ex.timestamps = fit(fq.timestamp_pools[index], VK_QUERY_TYPE_TIMESTAMP, 2 * scope_count, 0);
+	if (pipeline_statistics) {
+		ex.statistics = fit(fq.statistics_pools[index], VK_QUERY_TYPE_PIPELINE_STATISTICS, scope_count, pipeline_statistics);
+		ex.statistics_flags = pipeline_statistics;
+	}
+	return ex;
+}
+
 VkFramebuffer vuk::PerThreadContext::acquire_framebuffer(const vuk::FramebufferCreateInfo& fbci) {
 	return impl->framebuffer_cache.acquire(fbci);
 }
@@ -328,6 +438,48 @@ vuk::RGImage vuk::PerThreadContext::acquire_rendertarget(const vuk::RGCI& rgci)
 	return impl->transient_images.acquire(rgci);
 }
 
+vuk::TransientHeap vuk::PerThreadContext::acquire_transient_heap(const vuk::TransientHeapCreateInfo& thci) {
+	return impl->transient_heaps.acquire(thci);
+}
+
+VkCommandBuffer vuk::PerThreadContext::acquire_static_pass(Name name, uint64_t version, size_t key, Domain domain, const std::function<void(VkCommandBuffer, std::vector<DescriptorSet>&)>& record) {
+	auto& ctx_impl = *ctx.impl;
+	// recording is rare, so it happens under the lock, which also guards the command pools
+	std::lock_guard _(ctx_impl.static_passes_lock);
+	auto& recordings = ctx_impl.static_passes[std::string(name)];
+	// a new version invalidates the recordings of every key, previous frames may still execute them
+	auto stale = std::partition(recordings.begin(), recordings.end(), [&](auto& sp) { return sp.version == version; });
+	auto& recycle = ctx_impl.static_pass_recycle[ifc.frame];
+	recycle.insert(recycle.end(), std::make_move_iterator(stale), std::make_move_iterator(recordings.end()));
+	recordings.erase(stale, recordings.end());
+	for (auto& sp : recordings) {
+		if (sp.key == key && sp.domain == domain) {
+			sp.last_use = ifc.absolute_frame;
+			return sp.command_buffer;
+		}
+	}
+
+	auto& pool = ctx_impl.static_pass_pools[(size_t)domain];
+	if (pool == VK_NULL_HANDLE) {
+		VkCommandPoolCreateInfo cpci{ .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+		cpci.queueFamilyIndex = domain == Domain::eGraphics ? ctx.graphics_queue_family_index : ctx.compute_queue_family_index;
+		vkCreateCommandPool(ctx.device, &cpci, nullptr, &pool);
+	}
+	ContextImpl::StaticPass sp{ .version = version, .key = key, .domain = domain, .last_use = ifc.absolute_frame };
+	VkCommandBufferAllocateInfo cbai{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	cbai.commandPool = pool;
+	cbai.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	cbai.commandBufferCount = 1;
+	vkAllocateCommandBuffers(ctx.device, &cbai, &sp.command_buffer);
+	record(sp.command_buffer, sp.descriptor_sets);
+	recordings.push_back(std::move(sp));
+	return recordings.back().command_buffer;
+}
+
+vuk::TransientBuffers vuk::PerThreadContext::acquire_transient_buffers(const vuk::TransientBuffersCreateInfo& tbci) {
+	return impl->transient_buffers.acquire(tbci);
+}
+
 vuk::Sampler vuk::PerThreadContext::acquire_sampler(const vuk::SamplerCreateInfo& sci) {
 	return impl->sampler_cache.acquire(sci);
 }
@@ -35,6 +35,22 @@ namespace vuk {
 		return ret;
 	}
 
+	template<>
+	std::span<VkEvent> PooledType<VkEvent>::acquire(PerThreadContext& ptc, size_t count) {
+		if (values.size() < (needle + count)) {
+			auto remaining = values.size() - needle;
+			for (auto i = 0; i < (count - remaining); i++) {
+				VkEventCreateInfo eci{ .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO };
+				VkEvent event;
+				vkCreateEvent(ptc.ctx.device, &eci, nullptr, &event);
+				values.push_back(event);
+			}
+		}
+		std::span<VkEvent> ret{ &*values.begin() + needle, count };
+		needle += count;
+		return ret;
+	}
+
 	template<>
 	void PooledType<VkSemaphore>::free(Context& ctx) {
 		for (auto& v : values) {
@@ -49,8 +65,16 @@ namespace vuk {
 		}
 	}
 
+	template<>
+	void PooledType<VkEvent>::free(Context& ctx) {
+		for (auto& v : values) {
+			vkDestroyEvent(ctx.device, v, nullptr);
+		}
+	}
+
 	template struct PooledType<VkSemaphore>;
 	template struct PooledType<VkFence>;
+	template struct PooledType<VkEvent>;
 
 	template<>
 	void PooledType<VkFence>::reset(Context& ctx) {
@@ -61,20 +85,36 @@ namespace vuk {
 		needle = 0;
 	}
 
+	// the frame's fences have been waited on, so the events are no longer in use
+	template<>
+	void PooledType<VkEvent>::reset(Context& ctx) {
+		for (size_t i = 0; i < needle; i++) {
+			vkResetEvent(ctx.device, values[i]);
+		}
+		needle = 0;
+	}
+
 	// vk::CommandBuffer pool
 	PooledType<VkCommandBuffer>::PooledType(Context& ctx) {
 		VkCommandPoolCreateInfo cpci{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
-		vkCreateCommandPool(ctx.device, &cpci, nullptr, &pool);
+		cpci.queueFamilyIndex = ctx.graphics_queue_family_index;
+		vkCreateCommandPool(ctx.device, &cpci, nullptr, &pools[(size_t)Domain::eGraphics]);
 	}
 
-	std::span<VkCommandBuffer> PooledType<VkCommandBuffer>::acquire(PerThreadContext& ptc, VkCommandBufferLevel level, size_t count) {
-        auto& values = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? p_values : s_values;
-        auto& needle = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? p_needle : s_needle;
+	std::span<VkCommandBuffer> PooledType<VkCommandBuffer>::acquire(PerThreadContext& ptc, VkCommandBufferLevel level, size_t count, Domain domain) {
+		auto d = (size_t)domain;
+		if (pools[d] == VK_NULL_HANDLE) {
+			VkCommandPoolCreateInfo cpci{ .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+			cpci.queueFamilyIndex = ptc.ctx.compute_queue_family_index;
+			vkCreateCommandPool(ptc.ctx.device, &cpci, nullptr, &pools[d]);
+		}
+        auto& values = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? p_values[d] : s_values[d];
+        auto& needle = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? p_needle[d] : s_needle[d];
 		if (values.size() < (needle + count)) {
 			auto remaining = values.size() - needle;
 			VkCommandBufferAllocateInfo cbai{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
 			cbai.commandBufferCount = (unsigned)(count - remaining);
-			cbai.commandPool = pool;
+			cbai.commandPool = pools[d];
 			cbai.level = level;
 			auto ori_end = values.size();
 			values.resize(needle + count);
@@ -87,13 +127,21 @@ namespace vuk {
 
 	void PooledType<VkCommandBuffer>::reset(Context& ctx) {
 		VkCommandPoolResetFlags flags = {};
-		vkResetCommandPool(ctx.device, pool, flags);
-		p_needle = s_needle = 0;
+		for (size_t d = 0; d < domain_count; d++) {
+			if (pools[d] == VK_NULL_HANDLE)
+				continue;
+			vkResetCommandPool(ctx.device, pools[d], flags);
+			p_needle[d] = s_needle[d] = 0;
+		}
 	}
 
 	void PooledType<VkCommandBuffer>::free(Context& ctx) {
-		vkFreeCommandBuffers(ctx.device, pool, (uint32_t)p_values.size(), p_values.data());
-		vkFreeCommandBuffers(ctx.device, pool, (uint32_t)s_values.size(), s_values.data());
-		vkDestroyCommandPool(ctx.device, pool, nullptr);
+		for (size_t d = 0; d < domain_count; d++) {
+			if (pools[d] == VK_NULL_HANDLE)
+				continue;
+			vkFreeCommandBuffers(ctx.device, pools[d], (uint32_t)p_values[d].size(), p_values[d].data());
+			vkFreeCommandBuffers(ctx.device, pools[d], (uint32_t)s_values[d].size(), s_values[d].data());
+			vkDestroyCommandPool(ctx.device, pools[d], nullptr);
+		}
 	}
 }
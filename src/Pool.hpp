@@ -5,6 +5,7 @@
 #include <mutex>
 #include <vector>
 #include "vuk/vuk_fwd.hpp"
+#include "vuk/Types.hpp"
 #include <vulkan/vulkan.h>
 
 namespace vuk {
@@ -22,16 +23,21 @@ namespace vuk {
 	template<>
 	void PooledType<VkFence>::reset(Context& ctx);
 
+	template<>
+	void PooledType<VkEvent>::reset(Context& ctx);
+
 	template<>
 	struct PooledType<VkCommandBuffer> {
-		VkCommandPool pool;
-		std::vector<VkCommandBuffer> p_values;
-		std::vector<VkCommandBuffer> s_values;
-		size_t p_needle = 0;
-        size_t s_needle = 0;
+		// one command pool per Domain, the compute one is created on first use
+		static constexpr size_t domain_count = 2;
+		std::array<VkCommandPool, domain_count> pools = {};
+		std::array<std::vector<VkCommandBuffer>, domain_count> p_values;
+		std::array<std::vector<VkCommandBuffer>, domain_count> s_values;
+		std::array<size_t, domain_count> p_needle = {};
+		std::array<size_t, domain_count> s_needle = {};
 
 		PooledType(Context&);
-		std::span<VkCommandBuffer> acquire(PerThreadContext& ptc, VkCommandBufferLevel, size_t count);
+		std::span<VkCommandBuffer> acquire(PerThreadContext& ptc, VkCommandBufferLevel, size_t count, Domain domain = Domain::eGraphics);
 		void reset(Context&);
 		void free(Context&);
 	};
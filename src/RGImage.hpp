@@ -1,6 +1,10 @@
 #pragma once
 
 #include "vuk/Image.hpp"
+#include "vuk/Buffer.hpp"
+#include <vector>
+
+struct VmaAllocation_T;
 
 namespace vuk {
 	struct RGImage {
@@ -19,6 +23,48 @@ namespace vuk {
 	template<> struct create_info<RGImage> {
 		using type = RGCI;
 	};
+
+	// transient images of a rendergraph, images with disjoint lifetimes share memory
+	struct TransientHeap {
+		std::vector<RGImage> images;
+		// memory block, offset and size of each image
+		std::vector<uint32_t> blocks;
+		std::vector<VkDeviceSize> offsets;
+		std::vector<VkDeviceSize> sizes;
+		std::vector<VmaAllocation_T*> memory;
+	};
+	struct TransientHeapCreateInfo {
+		std::vector<RGCI> images;
+		// first and last renderpass using each image
+		std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+
+		bool operator==(const TransientHeapCreateInfo& other) const {
+			return std::tie(images, lifetimes) == std::tie(other.images, other.lifetimes);
+		}
+	};
+	template<> struct create_info<TransientHeap> {
+		using type = TransientHeapCreateInfo;
+	};
+
+	// transient buffers of a rendergraph with the same usage, suballocated from one buffer, buffers with disjoint lifetimes share memory
+	struct TransientBuffers {
+		vuk::Buffer buffer;
+		std::vector<VkDeviceSize> offsets;
+	};
+	struct TransientBuffersCreateInfo {
+		std::vector<size_t> sizes;
+		// usage of every buffer
+		vuk::BufferUsageFlags usage;
+		// first and last renderpass using each buffer
+		std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+
+		bool operator==(const TransientBuffersCreateInfo& other) const {
+			return std::tie(sizes, usage, lifetimes) == std::tie(other.sizes, other.usage, other.lifetimes);
+		}
+	};
+	template<> struct create_info<TransientBuffers> {
+		using type = TransientBuffersCreateInfo;
+	};
 }
 
 namespace std {
@@ -30,4 +76,33 @@ namespace std {
 			return h;
 		}
 	};
+
+	template <>
+	struct hash<vuk::TransientHeapCreateInfo> {
+		size_t operator()(vuk::TransientHeapCreateInfo const& x) const noexcept {
+			size_t h = 0;
+			for (auto& rgci : x.images) {
+				hash_combine(h, rgci);
+			}
+			for (auto& [first, last] : x.lifetimes) {
+				hash_combine(h, first, last);
+			}
+			return h;
+		}
+	};
+
+	template <>
+	struct hash<vuk::TransientBuffersCreateInfo> {
+		size_t operator()(vuk::TransientBuffersCreateInfo const& x) const noexcept {
+			size_t h = 0;
+			hash_combine(h, x.usage);
+			for (auto& size : x.sizes) {
+				hash_combine(h, size);
+			}
+			for (auto& [first, last] : x.lifetimes) {
+				hash_combine(h, first, last);
+			}
+			return h;
+		}
+	};
 };
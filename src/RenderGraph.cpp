@@ -2,13 +2,42 @@
 #include "RenderGraphUtil.hpp"
 #include "RenderGraphImpl.hpp"
 #include "vuk/Context.hpp"
+#include "ContextImpl.hpp"
 #include "vuk/Exception.hpp"
 #include <unordered_set>
+#include <queue>
+#include <algorithm>
 
 namespace vuk {
 	RenderGraph::RenderGraph() : impl(new RGImpl) {
 	}
 
+	RenderGraph::RenderGraph(InflightContext& ifc) {
+		auto& ctx_impl = *ifc.ctx.impl;
+		std::unique_ptr<arena> a;
+		{
+			std::lock_guard _(ctx_impl.arenas_lock);
+			if (!ctx_impl.arenas.empty()) {
+				a = std::move(ctx_impl.arenas.back());
+				ctx_impl.arenas.pop_back();
+			}
+		}
+		if (!a) {
+			a.reset(new arena(1024 * 128));
+		}
+		impl = new RGImpl(std::unique_ptr<arena, ArenaRecycler>(a.release(), ArenaRecycler{ &ctx_impl }));
+	}
+
+	void ArenaRecycler::operator()(arena* a) const noexcept {
+		if (!owner) {
+			delete a;
+			return;
+		}
+		a->reset();
+		std::lock_guard _(owner->arenas_lock);
+		owner->arenas.emplace_back(a);
+	}
+
 	RenderGraph::RenderGraph(RenderGraph&& o) noexcept : impl(std::exchange(o.impl, nullptr)) {}
 	RenderGraph& RenderGraph::operator=(RenderGraph&& o) noexcept {
 		impl = std::exchange(o.impl, nullptr);
@@ -28,6 +57,8 @@ namespace vuk {
 
 		impl->bound_attachments.insert(std::make_move_iterator(other.impl->bound_attachments.begin()), std::make_move_iterator(other.impl->bound_attachments.end()));
 		impl->bound_buffers.insert(std::make_move_iterator(other.impl->bound_buffers.begin()), std::make_move_iterator(other.impl->bound_buffers.end()));
+		impl->histories.insert(impl->histories.end(), std::make_move_iterator(other.impl->histories.begin()), std::make_move_iterator(other.impl->histories.end()));
+		impl->owned_names.insert(impl->owned_names.end(), std::make_move_iterator(other.impl->owned_names.begin()), std::make_move_iterator(other.impl->owned_names.end()));
 	}
 
 	void RenderGraph::add_alias(Name new_name, Name old_name) {
@@ -36,6 +67,206 @@ namespace vuk {
 		}
 	}
 
+	std::vector<uint32_t> topological_sort(std::vector<PassInfo>& passes, size_t resource_count) {
+		const uint32_t n = (uint32_t)passes.size();
+
+		// passes writing each resource
+		std::vector<std::vector<uint32_t>> producers(resource_count);
+		for (uint32_t i = 0; i < n; i++) {
+			for (auto& o : passes[i].outputs) {
+				producers[o.id].push_back(i);
+			}
+		}
+
+		// producer -> consumer edges, packed as (producer << 32 | consumer)
+		robin_hood::unordered_flat_set<uint64_t> edges;
+		for (uint32_t i = 0; i < n; i++) {
+			for (auto& in : passes[i].inputs) {
+				for (auto p : producers[in.id]) {
+					if (p != i) {
+						edges.emplace((uint64_t)p << 32 | i);
+					}
+				}
+			}
+		}
+
+		auto before = [&](uint32_t a, uint32_t b) {
+			auto ao = passes[a].pass.auxiliary_order;
+			auto bo = passes[b].pass.auxiliary_order;
+			return ao < bo || (ao == bo && a < b);
+		};
+
+		// write-after-write: independent passes writing the same resource run in auxiliary_order
+		std::vector<uint64_t> waw_edges;
+		for (auto& writers : producers) {
+			if (writers.size() < 2)
+				continue;
+			std::sort(writers.begin(), writers.end(), before);
+			for (size_t k = 0; k + 1 < writers.size(); k++) {
+				auto p = writers[k];
+				auto c = writers[k + 1];
+				if (!edges.count((uint64_t)p << 32 | c) && !edges.count((uint64_t)c << 32 | p)) {
+					waw_edges.push_back((uint64_t)p << 32 | c);
+				}
+			}
+		}
+		edges.insert(waw_edges.begin(), waw_edges.end());
+
+		std::vector<std::vector<uint32_t>> successors(n);
+		std::vector<uint32_t> indegree(n, 0);
+		for (auto e : edges) {
+			uint32_t p = (uint32_t)(e >> 32);
+			uint32_t c = (uint32_t)(e & 0xFFFFFFFF);
+			// passes depending on each other: keep only the edge agreeing with auxiliary_order
+			if (edges.count((uint64_t)c << 32 | p) && !before(p, c))
+				continue;
+			successors[p].push_back(c);
+			indegree[c]++;
+		}
+
+		// Kahn's algorithm, always picking the ready pass with the lowest auxiliary_order
+		auto after = [&](uint32_t a, uint32_t b) { return before(b, a); };
+		std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(after)> ready(after);
+		for (uint32_t i = 0; i < n; i++) {
+			if (indegree[i] == 0)
+				ready.push(i);
+		}
+
+		std::vector<uint32_t> order;
+		order.reserve(n);
+		while (!ready.empty()) {
+			auto i = ready.top();
+			ready.pop();
+			order.push_back(i);
+			for (auto s : successors[i]) {
+				if (--indegree[s] == 0)
+					ready.push(s);
+			}
+		}
+
+		if (order.size() != n) {
+			throw RenderGraphException{ "Cyclic dependency between passes" };
+		}
+
+		std::vector<PassInfo> sorted;
+		sorted.reserve(n);
+		for (auto i : order) {
+			sorted.emplace_back(std::move(passes[i]));
+		}
+		passes = std::move(sorted);
+		return order;
+	}
+
+	// walk back from the sinks (external images, swapchains and buffers with a final use) and remove passes that don't reach them
+	// passes without outputs are kept, as we can't know what they are for
+	void cull_passes(RGImpl& impl) {
+		std::vector<bool> needed(impl.resource_names.size(), false);
+		for (auto& [name, att] : impl.bound_attachments) {
+			if (att.type != AttachmentRPInfo::Type::eInternal) {
+				needed[att.id] = true;
+			}
+		}
+		for (auto& [name, buf] : impl.bound_buffers) {
+			if (buf.final.access != vuk::AccessFlags{}) {
+				needed[buf.id] = true;
+			}
+		}
+
+		// passes are sorted, so every consumer is visited before its producers
+		std::vector<bool> live(impl.passes.size(), false);
+		for (size_t i = impl.passes.size(); i-- > 0;) {
+			auto& pif = impl.passes[i];
+			bool is_live = pif.outputs.empty();
+			for (auto& o : pif.outputs) {
+				if (needed[o.id]) {
+					is_live = true;
+					break;
+				}
+			}
+			if (!is_live)
+				continue;
+			live[i] = true;
+			for (auto& in : pif.inputs) {
+				needed[in.id] = true;
+			}
+		}
+
+		impl.culled_passes.clear();
+		if (std::find(live.begin(), live.end(), false) == live.end())
+			return;
+
+		std::vector<PassInfo> kept;
+		std::vector<uint32_t> kept_order;
+		kept.reserve(impl.passes.size());
+		kept_order.reserve(impl.passes.size());
+		for (size_t i = 0; i < impl.passes.size(); i++) {
+			if (live[i]) {
+				kept.emplace_back(std::move(impl.passes[i]));
+				kept_order.push_back(impl.pass_order[i]);
+			} else {
+				impl.culled_passes.push_back(impl.passes[i].pass.name);
+			}
+		}
+		impl.passes = std::move(kept);
+		impl.pass_order = std::move(kept_order);
+	}
+
+	// managed attachments that no remaining pass uses are not created
+	void remove_unused_transients(RGImpl& impl) {
+		for (auto it = impl.bound_attachments.begin(); it != impl.bound_attachments.end();) {
+			if (it->second.type == AttachmentRPInfo::Type::eInternal && impl.use_chains[it->second.id].empty()) {
+				it = impl.bound_attachments.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	// assign dense ids to resource names, resolving aliases once
+	// names used by passes are numbered first and in add order, so graphs with the same structure agree on them
+	void intern_resources(RGImpl& impl) {
+		impl.resource_ids.clear();
+		impl.resource_names.clear();
+		auto intern = [&](Name name) {
+			if (auto it = impl.resource_ids.find(name); it != impl.resource_ids.end())
+				return it->second;
+			auto resolved = resolve_name(name, impl.aliases);
+			uint32_t id;
+			if (auto it = impl.resource_ids.find(resolved); it != impl.resource_ids.end()) {
+				id = it->second;
+			} else {
+				id = (uint32_t)impl.resource_names.size();
+				impl.resource_names.push_back(resolved);
+				impl.resource_ids.emplace(resolved, id);
+			}
+			impl.resource_ids.emplace(name, id);
+			return id;
+		};
+		for (auto& pif : impl.passes) {
+			for (auto& res : pif.pass.resources) {
+				res.id = intern(res.name);
+			}
+		}
+		for (auto& [name, att] : impl.bound_attachments) {
+			att.id = intern(name);
+		}
+		for (auto& [name, buf] : impl.bound_buffers) {
+			buf.id = intern(name);
+		}
+	}
+
+	// point the id-indexed slots at the attached resources, once the set of attachments is final
+	void index_bound_resources(RGImpl& impl) {
+		impl.attachment_slots.assign(impl.resource_names.size(), nullptr);
+		impl.buffer_slots.assign(impl.resource_names.size(), nullptr);
+		for (auto& [name, att] : impl.bound_attachments) {
+			impl.attachment_slots[att.id] = &att;
+		}
+		for (auto& [name, buf] : impl.bound_buffers) {
+			impl.buffer_slots[buf.id] = &buf;
+		}
+	}
+
 	// determine rendergraph inputs and outputs, and resources that are neither
 	void RenderGraph::build_io() {
 		impl->global_inputs.clear();
@@ -53,6 +284,8 @@ namespace vuk {
 					pif.outputs.insert(res);
 				}
 			}
+			bool compute_only = pif.pass.resources.size() > 0 && std::all_of(pif.pass.resources.begin(), pif.pass.resources.end(), [](auto& res) { return is_compute_access(res.ia); });
+			pif.domain = compute_only ? Domain::eCompute : Domain::eGraphics;
 
 			for (auto& i : pif.inputs) {
 				if (impl->global_outputs.erase(i) == 0) {
@@ -74,55 +307,46 @@ namespace vuk {
 	}
 
 	void RenderGraph::compile() {
+		intern_resources(*impl);
+
 		// find which reads are graph inputs (not produced by any pass) & outputs (not consumed by any pass)
 		build_io();
 
 		// sort passes
-		if (impl->passes.size() > 1) {
-			topological_sort(impl->passes.begin(), impl->passes.end(), [this](const auto& p1, const auto& p2) {
-				bool could_execute_after = false;
-				bool could_execute_before = false;
-				for (auto& o : p1.outputs) {
-					for (auto& i : p2.inputs) {
-						if (o.name == resolve_name(i.name, impl->aliases))
-							could_execute_after = true;
-					}
-				}
-				for (auto& o : p2.outputs) {
-					for (auto& i : p1.inputs) {
-						if (o.name == resolve_name(i.name, impl->aliases))
-							could_execute_before = true;
-					}
-				}
-				if (!could_execute_after && !could_execute_before && p1.outputs == p2.outputs) {
-					return p1.pass.auxiliary_order < p2.pass.auxiliary_order;
-				}
+		impl->pass_order = topological_sort(impl->passes, impl->resource_names.size());
 
-				if (could_execute_after && could_execute_before) {
-					return p1.pass.auxiliary_order < p2.pass.auxiliary_order;
-				} else if (could_execute_after) {
-					return true;
-				} else
-					return false;
-				});
-		}
+		// remove passes not contributing to any sink
+		cull_passes(*impl);
 
 		impl->use_chains.clear();
+		impl->use_chains.resize(impl->resource_names.size(), UseChain{ short_alloc<UseRef, 64>{*impl->arena_} });
 		// assemble use chains
 		for (auto& passinfo : impl->passes) {
 			for (auto& res : passinfo.pass.resources) {
-				auto it = impl->use_chains.find(resolve_name(res.name, impl->aliases));
-				if (it == impl->use_chains.end()) {
-					it = impl->use_chains.emplace(resolve_name(res.name, impl->aliases), std::vector<UseRef, short_alloc<UseRef, 64>>{short_alloc<UseRef, 64>{*impl->arena_}}).first;
-				}
-				it->second.emplace_back(UseRef{ to_use(res.ia), &passinfo });
+				impl->use_chains[res.id].emplace_back(UseRef{ to_use(res.ia), &passinfo, res.subrange });
 			}
 		}
+		remove_unused_transients(*impl);
+		index_bound_resources(*impl);
 
 		// we need to collect passes into framebuffers, which will determine the renderpasses
 		using attachment_set = std::unordered_set<Resource, std::hash<Resource>, std::equal_to<Resource>, short_alloc<Resource, 16>>;
 		using passinfo_vec = std::vector<PassInfo*, short_alloc<PassInfo*, 16>>;
 		std::vector<std::pair<attachment_set, passinfo_vec>, short_alloc<std::pair<attachment_set, passinfo_vec>, 8>> attachment_sets{ *impl->arena_ };
+		// a pass reading attachments of the previous renderpass as input attachments joins it as a later subpass,
+		// unless it also accesses one of those attachments outside of the framebuffer
+		auto reads_as_input = [](const attachment_set& atts, const PassInfo& passinfo) {
+			bool reads = false;
+			for (auto& res : passinfo.pass.resources) {
+				bool in_set = std::any_of(atts.begin(), atts.end(), [&](auto& att) { return att.id == res.id; });
+				if (!in_set)
+					continue;
+				if (!is_framebuffer_attachment(res))
+					return false;
+				reads |= res.ia == vuk::eInputRead;
+			}
+			return reads;
+		};
 		for (auto& passinfo : impl->passes) {
 			attachment_set atts{ *impl->arena_ };
 
@@ -131,7 +355,12 @@ namespace vuk {
 					atts.insert(res);
 			}
 
-			if (auto p = attachment_sets.size() > 0 && attachment_sets.back().first == atts ? &attachment_sets.back() : nullptr) {
+			// passes that could go to another queue don't share a renderpass
+			auto p = attachment_sets.size() > 0 && attachment_sets.back().second.back()->domain == passinfo.domain ? &attachment_sets.back() : nullptr;
+			if (p && p->first == atts) {
+				p->second.push_back(&passinfo);
+			} else if (p && p->first.size() > 0 && reads_as_input(p->first, passinfo)) {
+				p->first.insert(atts.begin(), atts.end());
 				p->second.push_back(&passinfo);
 			} else {
 				passinfo_vec pv{ *impl->arena_ };
@@ -170,13 +399,22 @@ namespace vuk {
 			}
 			for (auto& att : attachments) {
 				AttachmentRPInfo info;
-				info.name = resolve_name(att.name, impl->aliases);
+				info.name = impl->resource_names[att.id];
+				info.id = att.id;
 				rpi.attachments.push_back(info);
 			}
 
 			if (attachments.size() == 0) {
 				rpi.framebufferless = true;
+			} else {
+				// static passes are replayed from secondaries, which need secondary contents inside a renderpass
+				for (auto& sp : rpi.subpasses) {
+					for (auto& p : sp.passes) {
+						sp.use_secondary_command_buffers |= p->pass.static_version.has_value();
+					}
+				}
 			}
+			rpi.domain = passes[0]->domain;
 
 			impl->rpis.push_back(rpi);
 		}
@@ -256,11 +494,41 @@ namespace vuk {
 		impl->bound_buffers.emplace(name, buf_info);
 	}
 
+	void RenderGraph::attach_managed_buffer(Name name, size_t size, BufferUsageFlags usage) {
+		assert(size > 0);
+		BufferInfo buf_info{ .name = name, .initial = to_use(eNone), .final = to_use(eNone), .managed = true, .size = size, .usage = usage };
+		impl->bound_buffers.emplace(name, buf_info);
+	}
+
+	void RenderGraph::attach_history(Name name, ImageCreateInfo ici, uint32_t n_versions) {
+		assert(n_versions > 0);
+		RGImpl::History history{ .name = name, .ici = ici };
+		for (uint32_t i = 0; i < n_versions; i++) {
+			Name version = name;
+			if (i > 0) {
+				version = *impl->owned_names.emplace_back(std::make_unique<std::string>(std::string(name) + "_" + std::to_string(i)));
+			}
+			history.versions.push_back(version);
+
+			AttachmentRPInfo attachment_info;
+			attachment_info.extents = vuk::Dimension2D::absolute(ici.extent.width, ici.extent.height);
+			attachment_info.type = AttachmentRPInfo::Type::eExternal;
+			attachment_info.description.format = (VkFormat)ici.format;
+			attachment_info.samples = ici.samples;
+			attachment_info.history = true;
+			// image and initial use are bound by link
+			impl->bound_attachments.emplace(version, attachment_info);
+		}
+		impl->histories.push_back(std::move(history));
+	}
+
 	void RenderGraph::attach_image(Name name, ImageAttachment att, Access initial_acc, Access final_acc) {
 		AttachmentRPInfo attachment_info;
 		attachment_info.extents = vuk::Dimension2D::absolute(att.extent);
 		attachment_info.image = att.image;
 		attachment_info.iv = att.image_view;
+		attachment_info.base_level = att.base_level;
+		attachment_info.base_layer = att.base_layer;
 
 		attachment_info.type = AttachmentRPInfo::Type::eExternal;
 		attachment_info.description.format = (VkFormat)att.format;
@@ -287,199 +555,1061 @@ namespace vuk {
 	}
 
 	void RenderGraph::validate() {
-		// check if all resourced are attached
-		for (const auto& [n, v] : impl->use_chains) {
-			if (!impl->bound_attachments.contains(n) && !impl->bound_buffers.contains(n)) {
+		for (uint32_t id = 0; id < impl->use_chains.size(); id++) {
+			auto& chain = impl->use_chains[id];
+			if (chain.empty())
+				continue;
+			auto n = impl->resource_names[id];
+			// check if all resourced are attached
+			if (!impl->attachment_slots[id] && !impl->buffer_slots[id]) {
 				throw RenderGraphException{ std::string("Missing resource: \"") + std::string(n) + "\". Did you forget to attach it?" };
 			}
+			// framebuffer attachments are bound through a view of the whole image
+			for (const auto& ur : chain) {
+				if (is_framebuffer_attachment(ur.use) && !(ur.subrange == Resource::Subrange{})) {
+					throw RenderGraphException{ std::string("Attachment \"") + std::string(n) + "\" of pass \"" + std::string(ur.pass->pass.name) + "\" is used as a framebuffer attachment with a subrange." };
+				}
+			}
+		}
+	}
+
+	// canonical encoding of everything that determines the compiled products, including the Context state link() reads
+	// concrete images, buffers, extents and clear values are rebound on every link, so they are left out
+	std::string structure_key(const RGImpl& impl, bool dynamic_rendering, bool async_compute) {
+		std::string key;
+		auto put = [&](auto v) {
+			key.append(reinterpret_cast<const char*>(&v), sizeof(v));
+		};
+		auto put_name = [&](Name n) {
+			put(n.size());
+			key.append(n);
+		};
+		auto put_use = [&](const Resource::Use& u) {
+			put((VkPipelineStageFlags)u.stages);
+			put((VkAccessFlags)u.access);
+			put(u.layout);
+			put(u.stages2);
+		};
+
+		put(dynamic_rendering);
+		put(async_compute);
+		put(impl.passes.size());
+		for (auto& pif : impl.passes) {
+			auto& p = pif.pass;
+			put_name(p.name);
+			put(p.auxiliary_order);
+			put(p.use_secondary_command_buffers);
+			put(p.static_version.has_value());
+			put(p.resources.size());
+			for (auto& r : p.resources) {
+				put_name(r.name);
+				put(r.type);
+				put(r.ia);
+				put(r.subrange.base_level);
+				put(r.subrange.level_count);
+				put(r.subrange.base_layer);
+				put(r.subrange.layer_count);
+			}
+			// unordered containers are encoded in name order
+			std::vector<std::pair<Name, Name>> resolves;
+			for (auto& [src, dst] : p.resolves) {
+				resolves.emplace_back(src, dst);
+			}
+			std::sort(resolves.begin(), resolves.end());
+			put(resolves.size());
+			for (auto& [src, dst] : resolves) {
+				put_name(src);
+				put_name(dst);
+			}
+		}
+
+		std::vector<std::pair<Name, Name>> aliases;
+		for (auto& [new_name, old_name] : impl.aliases) {
+			aliases.emplace_back(new_name, old_name);
+		}
+		std::sort(aliases.begin(), aliases.end());
+		put(aliases.size());
+		for (auto& [new_name, old_name] : aliases) {
+			put_name(new_name);
+			put_name(old_name);
+		}
+
+		std::vector<const decltype(impl.bound_attachments)::value_type*> attachments;
+		for (auto& e : impl.bound_attachments) {
+			attachments.push_back(&e);
+		}
+		std::sort(attachments.begin(), attachments.end(), [](auto a, auto b) { return a->first < b->first; });
+		put(attachments.size());
+		for (auto* e : attachments) {
+			auto& att = e->second;
+			put_name(e->first);
+			put(att.type);
+			put(att.description.format);
+			put(att.samples.count);
+			put(att.samples.infer);
+			put(att.should_clear);
+			put_use(att.initial);
+			put_use(att.final);
+		}
+
+		std::vector<const decltype(impl.bound_buffers)::value_type*> buffers;
+		for (auto& e : impl.bound_buffers) {
+			buffers.push_back(&e);
+		}
+		std::sort(buffers.begin(), buffers.end(), [](auto a, auto b) { return a->first < b->first; });
+		put(buffers.size());
+		for (auto* e : buffers) {
+			auto& buf = e->second;
+			put_name(e->first);
+			put_use(buf.initial);
+			put_use(buf.final);
+			put(buf.managed);
+		}
+		return key;
+	}
+
+	// point the Vulkan structure back into our own storage after a copy
+	void fixup_renderpass_pointers(RenderPassCreateInfo& rpci) {
+		for (size_t i = 0; i < rpci.subpass_descriptions.size(); i++) {
+			auto& sd = rpci.subpass_descriptions[i];
+			sd.pColorAttachments = rpci.color_refs.data() + rpci.color_ref_offsets[i];
+			sd.pResolveAttachments = rpci.resolve_refs.data() + rpci.color_ref_offsets[i];
+			sd.pDepthStencilAttachment = rpci.ds_refs[i] ? &*rpci.ds_refs[i] : nullptr;
+			sd.pInputAttachments = rpci.input_refs.data() + rpci.input_ref_offsets[i];
+			sd.pPreserveAttachments = rpci.preserve_refs.data() + rpci.preserve_ref_offsets[i];
+		}
+		rpci.pSubpasses = rpci.subpass_descriptions.data();
+		rpci.pDependencies = rpci.subpass_dependencies.data();
+		rpci.pAttachments = rpci.attachments.data();
+	}
+
+	// copy pass placement, use chains and renderpasses (with barriers) from src to dst
+	// dst.passes must correspond to src.passes one-to-one, and resource ids must agree; attachment names are left to the caller
+	void copy_compiled(const RGImpl& src, RGImpl& dst) {
+		auto pass_ptr = [&](const PassInfo* p) -> PassInfo* {
+			return p ? &dst.passes[p - src.passes.data()] : nullptr;
+		};
+
+		dst.pass_order = src.pass_order;
+		for (size_t i = 0; i < src.passes.size(); i++) {
+			dst.passes[i].render_pass_index = src.passes[i].render_pass_index;
+			dst.passes[i].subpass = src.passes[i].subpass;
+		}
+
+		dst.use_chains.clear();
+		dst.use_chains.resize(src.use_chains.size(), UseChain{ short_alloc<UseRef, 64>{*dst.arena_} });
+		for (size_t id = 0; id < src.use_chains.size(); id++) {
+			for (auto& ur : src.use_chains[id]) {
+				dst.use_chains[id].emplace_back(UseRef{ ur.use, pass_ptr(ur.pass), ur.subrange });
+			}
+		}
+
+		dst.rpis.clear();
+		dst.rpis.reserve(src.rpis.size());
+		for (auto& rp : src.rpis) {
+			RenderPassInfo rpi{ *dst.arena_ };
+			for (auto& sp : rp.subpasses) {
+				SubpassInfo si{ *dst.arena_ };
+				si.use_secondary_command_buffers = sp.use_secondary_command_buffers;
+				for (auto& p : sp.passes) {
+					si.passes.push_back(pass_ptr(p));
+				}
+				si.pre_barriers = sp.pre_barriers;
+				si.post_barriers = sp.post_barriers;
+				si.pre_mem_barriers = sp.pre_mem_barriers;
+				si.post_mem_barriers = sp.post_mem_barriers;
+				si.set_events = sp.set_events;
+				si.wait_events = sp.wait_events;
+				rpi.subpasses.push_back(si);
+			}
+			for (auto& att : rp.attachments) {
+				rpi.attachments.push_back(att);
+			}
+			rpi.rpci = rp.rpci;
+			fixup_renderpass_pointers(rpi.rpci);
+			rpi.framebufferless = rp.framebufferless;
+			rpi.dynamic_rendering = rp.dynamic_rendering;
+			rpi.handle = rp.handle;
+			rpi.domain = rp.domain;
+			rpi.batch = rp.batch;
+			dst.rpis.push_back(rpi);
+		}
+
+		dst.event_count = src.event_count;
+		dst.batches = src.batches;
+	}
+
+	// without a renderpass object, attachments are transitioned and external dependencies are satisfied by barriers around the rendering
+	// dependencies into the renderpass also cover the initial layout transitions, as the implicit external dependency would when there are none
+	void lower_to_barriers(RenderPassInfo& rp) {
+		auto& rpci = rp.rpci;
+		auto& sd = rpci.subpass_descriptions[0];
+		auto& sp = rp.subpasses[0];
+
+		// layout of every attachment while rendering
+		std::vector<VkImageLayout> layouts(rpci.attachments.size(), VK_IMAGE_LAYOUT_UNDEFINED);
+		for (uint32_t i = 0; i < sd.colorAttachmentCount; i++) {
+			layouts[sd.pColorAttachments[i].attachment] = sd.pColorAttachments[i].layout;
+			if (sd.pResolveAttachments && sd.pResolveAttachments[i].attachment != VK_ATTACHMENT_UNUSED) {
+				layouts[sd.pResolveAttachments[i].attachment] = sd.pResolveAttachments[i].layout;
+			}
+		}
+		if (sd.pDepthStencilAttachment) {
+			layouts[sd.pDepthStencilAttachment->attachment] = sd.pDepthStencilAttachment->layout;
+		}
+
+		VkPipelineStageFlags in_src = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, in_dst = 0, out_src = 0, out_dst = 0;
+		VkAccessFlags in_src_access = 0, in_dst_access = 0, out_src_access = 0, out_dst_access = 0;
+		bool has_in = false, has_out = false;
+		for (auto& dep : rpci.subpass_dependencies) {
+			if (dep.srcSubpass == VK_SUBPASS_EXTERNAL) {
+				has_in = true;
+				in_src |= dep.srcStageMask;
+				in_dst |= dep.dstStageMask;
+				in_src_access |= dep.srcAccessMask;
+				in_dst_access |= dep.dstAccessMask;
+			} else if (dep.dstSubpass == VK_SUBPASS_EXTERNAL) {
+				has_out = true;
+				out_src |= dep.srcStageMask;
+				out_dst |= dep.dstStageMask;
+				out_src_access |= dep.srcAccessMask;
+				out_dst_access |= dep.dstAccessMask;
+			}
+		}
+		// attachment accesses while rendering
+		VkPipelineStageFlags attachment_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		VkAccessFlags attachment_writes = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		VkAccessFlags attachment_access = attachment_writes | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		in_dst |= attachment_stages;
+		in_dst_access |= attachment_access;
+		// the final layout transition is ordered before the next use by its own dependency, or by the semaphore of presentation
+		out_src |= attachment_stages;
+		out_src_access |= attachment_writes;
+		if (out_dst == 0) {
+			out_dst = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		}
+
+		auto in = vuk::PipelineStageFlags(in_src), in_to = vuk::PipelineStageFlags(in_dst);
+		auto out = vuk::PipelineStageFlags(out_src), out_to = vuk::PipelineStageFlags(out_dst);
+		for (size_t i = 0; i < rpci.attachments.size(); i++) {
+			auto& desc = rpci.attachments[i];
+			if (layouts[i] == VK_IMAGE_LAYOUT_UNDEFINED)
+				continue;
+			VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+			// the mip level and layer of the attached view are filled in when emitted
+			barrier.subresourceRange = { (VkImageAspectFlags)format_to_aspect((vuk::Format)desc.format), 0, 1, 0, 1 };
+			if (desc.initialLayout != layouts[i]) {
+				barrier.srcAccessMask = in_src_access;
+				barrier.dstAccessMask = in_dst_access;
+				barrier.oldLayout = desc.initialLayout;
+				barrier.newLayout = layouts[i];
+				sp.pre_barriers.push_back(ImageBarrier{ .image = rp.attachments[i].id, .barrier = barrier, .src = in, .dst = in_to, .attachment_view = true });
+			}
+			if (desc.finalLayout != layouts[i]) {
+				barrier.srcAccessMask = out_src_access;
+				barrier.dstAccessMask = out_dst_access;
+				barrier.oldLayout = layouts[i];
+				barrier.newLayout = desc.finalLayout;
+				sp.post_barriers.push_back(ImageBarrier{ .image = rp.attachments[i].id, .barrier = barrier, .src = out, .dst = out_to, .attachment_view = true });
+			}
+		}
+		// attachments not changing layout still need the dependencies
+		if (has_in) {
+			MemoryBarrier mb;
+			mb.barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = in_src_access, .dstAccessMask = in_dst_access };
+			mb.src = in;
+			mb.dst = in_to;
+			sp.pre_mem_barriers.push_back(mb);
+		}
+		if (has_out) {
+			MemoryBarrier mb;
+			mb.barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = out_src_access, .dstAccessMask = out_dst_access };
+			mb.src = out;
+			mb.dst = out_to;
+			sp.post_mem_barriers.push_back(mb);
+		}
+	}
+
+	// snapshot the compiled products of src, with names owned by the snapshot
+	void store_compiled(const RGImpl& src, CompiledRenderGraph& dst) {
+		robin_hood::unordered_flat_map<Name, Name> interned;
+		auto intern = [&](Name n) -> Name {
+			auto it = interned.find(n);
+			if (it != interned.end())
+				return it->second;
+			Name owned = dst.names.emplace_back(n);
+			interned.emplace(n, owned);
+			return owned;
+		};
+
+		dst.impl.passes.reserve(src.passes.size());
+		for (size_t i = 0; i < src.passes.size(); i++) {
+			dst.impl.passes.emplace_back(*dst.impl.arena_, Pass{});
+		}
+		copy_compiled(src, dst.impl);
+		for (auto& name : src.resource_names) {
+			dst.impl.resource_names.push_back(intern(name));
+		}
+		for (auto& rp : dst.impl.rpis) {
+			for (auto& att : rp.attachments) {
+				att.name = dst.impl.resource_names[att.id];
+			}
+		}
+	}
+
+	// apply a snapshot to a graph with the same structure, keeping its callbacks and concrete resources
+	void reuse_compiled(const CompiledRenderGraph& src, RGImpl& dst) {
+		// ids are assigned in add order, before the passes are reordered
+		intern_resources(dst);
+
+		// passes missing from the snapshot's order were culled
+		std::vector<bool> kept(dst.passes.size(), false);
+		std::vector<PassInfo> sorted;
+		sorted.reserve(dst.passes.size());
+		for (auto i : src.impl.pass_order) {
+			kept[i] = true;
+			sorted.emplace_back(std::move(dst.passes[i]));
+		}
+		dst.culled_passes.clear();
+		for (size_t i = 0; i < kept.size(); i++) {
+			if (!kept[i])
+				dst.culled_passes.push_back(dst.passes[i].pass.name);
+		}
+		dst.passes = std::move(sorted);
+
+		copy_compiled(src.impl, dst);
+		// attached resources no pass uses are numbered after the snapshot's
+		dst.use_chains.resize(dst.resource_names.size(), UseChain{ short_alloc<UseRef, 64>{*dst.arena_} });
+		remove_unused_transients(dst);
+		index_bound_resources(dst);
+
+		for (auto& rp : dst.rpis) {
+			for (auto& att : rp.attachments) {
+				att.name = dst.resource_names[att.id];
+				auto bound = dst.attachment_slots[att.id];
+				if (!bound)
+					continue;
+				att.iv = bound->iv;
+				att.extents = bound->extents;
+				att.clear_value = bound->clear_value;
+			}
+		}
+	}
+
+	void add_wait(QueueBatch& dst, size_t src, vuk::PipelineStageFlags stages) {
+		for (auto& [batch, wait_stages] : dst.waits) {
+			if (batch == src) {
+				wait_stages |= stages;
+				return;
+			}
+		}
+		dst.waits.emplace_back(src, stages);
+	}
+
+	// assign renderpasses to queues and partition them into batches
+	// compute work after the first use of a swapchain image stays on graphics, so that only the last batch touches the swapchain
+	void schedule_queues(RGImpl& impl, bool async_compute) {
+		robin_hood::unordered_flat_set<Name> swapchain_images;
+		for (auto& [name, att] : impl.bound_attachments) {
+			if (att.type == AttachmentRPInfo::Type::eSwapchain) {
+				swapchain_images.insert(resolve_name(name, impl.aliases));
+			}
+		}
+
+		bool after_swapchain = !async_compute;
+		for (auto& rp : impl.rpis) {
+			for (auto& sp : rp.subpasses) {
+				for (auto& p : sp.passes) {
+					for (auto& res : p->pass.resources) {
+						after_swapchain |= swapchain_images.contains(resolve_name(res.name, impl.aliases));
+					}
+				}
+			}
+			if (after_swapchain) {
+				rp.domain = Domain::eGraphics;
+			}
+		}
+
+		impl.batches.clear();
+		auto open_batch = [&](Domain domain, size_t rp_begin) {
+			QueueBatch batch;
+			batch.domain = domain;
+			batch.rp_begin = batch.rp_end = rp_begin;
+			impl.batches.push_back(std::move(batch));
+		};
+		open_batch(Domain::eGraphics, 0);
+		for (size_t i = 0; i < impl.rpis.size(); i++) {
+			if (impl.batches.back().domain != impl.rpis[i].domain) {
+				open_batch(impl.rpis[i].domain, i);
+			}
+			impl.rpis[i].batch = impl.batches.size() - 1;
+			impl.batches.back().rp_end = i + 1;
+		}
+		if (impl.batches.back().domain != Domain::eGraphics) {
+			open_batch(Domain::eGraphics, impl.rpis.size());
+		}
+		// the last batch is submitted by the caller, with their fence: make it cover the compute queue too
+		if (impl.batches.size() > 1) {
+			add_wait(impl.batches.back(), impl.batches.size() - 2, vuk::PipelineStageFlagBits::eBottomOfPipe);
+		}
+	}
+
+	// batches of the two ends of a use, chain ends belong to the first and last (graphics) batches
+	std::pair<size_t, size_t> use_batches(const RGImpl& impl, const UseRef& left, const UseRef& right) {
+		auto left_batch = left.pass ? impl.rpis[left.pass->render_pass_index].batch : 0;
+		auto right_batch = right.pass ? impl.rpis[right.pass->render_pass_index].batch : impl.batches.size() - 1;
+		return { left_batch, right_batch };
+	}
+
+	// end of a subrange along one axis, VK_REMAINING_* extends to the end of the image
+	uint32_t subrange_end(uint32_t base, uint32_t count) {
+		return count == VK_REMAINING_MIP_LEVELS ? VK_REMAINING_MIP_LEVELS : base + count;
+	}
+
+	uint32_t subrange_count(uint32_t base, uint32_t end) {
+		return end == VK_REMAINING_MIP_LEVELS ? VK_REMAINING_MIP_LEVELS : end - base;
+	}
+
+	VkImageSubresourceRange to_subresource_range(vuk::ImageAspectFlags aspect, const Resource::Subrange& subrange) {
+		return { (VkImageAspectFlags)aspect, subrange.base_level, subrange.level_count, subrange.base_layer, subrange.layer_count };
+	}
+
+	// split an image into the largest subranges on which every use in the chain acts as a whole
+	// each subrange gets the use chain of the uses covering it, neighbouring subranges with the same uses are merged
+	// subranges only touched by the chain ends need no sync and are dropped
+	std::vector<std::pair<Resource::Subrange, std::vector<UseRef>>> subresource_chains(std::span<const UseRef> chain) {
+		std::vector<uint32_t> levels = { 0, VK_REMAINING_MIP_LEVELS };
+		std::vector<uint32_t> layers = { 0, VK_REMAINING_ARRAY_LAYERS };
+		for (auto& ur : chain) {
+			levels.push_back(ur.subrange.base_level);
+			levels.push_back(subrange_end(ur.subrange.base_level, ur.subrange.level_count));
+			layers.push_back(ur.subrange.base_layer);
+			layers.push_back(subrange_end(ur.subrange.base_layer, ur.subrange.layer_count));
+		}
+		std::sort(levels.begin(), levels.end());
+		levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+		std::sort(layers.begin(), layers.end());
+		layers.erase(std::unique(layers.begin(), layers.end()), layers.end());
+
+		std::vector<std::pair<Resource::Subrange, std::vector<UseRef>>> result;
+		// whole image uses only
+		if (levels.size() == 2 && layers.size() == 2) {
+			result.emplace_back(Resource::Subrange{}, std::vector<UseRef>(chain.begin(), chain.end()));
+			return result;
+		}
+
+		auto covers = [](const Resource::Subrange& r, const Resource::Subrange& cell) {
+			return r.base_level <= cell.base_level && subrange_end(r.base_level, r.level_count) >= subrange_end(cell.base_level, cell.level_count) &&
+				r.base_layer <= cell.base_layer && subrange_end(r.base_layer, r.layer_count) >= subrange_end(cell.base_layer, cell.layer_count);
+		};
+
+		// cells as indices into the chain, so that uses compare by identity
+		std::vector<std::pair<Resource::Subrange, std::vector<size_t>>> cells;
+		size_t prev_row = 0;
+		for (size_t l = 0; l + 1 < layers.size(); l++) {
+			size_t row = cells.size();
+			for (size_t m = 0; m + 1 < levels.size(); m++) {
+				Resource::Subrange cell{ levels[m], subrange_count(levels[m], levels[m + 1]), layers[l], subrange_count(layers[l], layers[l + 1]) };
+				std::vector<size_t> uses;
+				for (size_t i = 0; i < chain.size(); i++) {
+					if (covers(chain[i].subrange, cell))
+						uses.push_back(i);
+				}
+				if (cells.size() > row && cells.back().second == uses) {
+					cells.back().first.level_count = subrange_count(cells.back().first.base_level, levels[m + 1]);
+				} else {
+					cells.emplace_back(cell, std::move(uses));
+				}
+			}
+			// a row of layers split the same way as the previous one extends it
+			bool same_as_prev = row > 0 && cells.size() - row == row - prev_row;
+			for (size_t i = 0; same_as_prev && i < row - prev_row; i++) {
+				auto& a = cells[prev_row + i];
+				auto& b = cells[row + i];
+				same_as_prev = a.first.base_level == b.first.base_level && a.first.level_count == b.first.level_count && a.second == b.second;
+			}
+			if (same_as_prev) {
+				for (size_t i = prev_row; i < row; i++) {
+					cells[i].first.layer_count = subrange_count(cells[i].first.base_layer, layers[l + 1]);
+				}
+				cells.resize(row);
+			} else {
+				prev_row = row;
+			}
+		}
+
+		for (auto& [subrange, uses] : cells) {
+			if (std::none_of(uses.begin(), uses.end(), [&](size_t i) { return chain[i].pass != nullptr; }))
+				continue;
+			auto& sub_chain = result.emplace_back(subrange, std::vector<UseRef>{}).second;
+			for (auto i : uses) {
+				sub_chain.push_back(chain[i]);
+			}
+		}
+		return result;
+	}
+
+	// an image use crossing queues: the queues are ordered with a semaphore, the layout transition is done on the acquiring side
+	// and ownership is transferred if the queue families differ
+	void link_image_across_queues(RGImpl& impl, uint32_t id, vuk::ImageAspectFlags aspect, const Resource::Subrange& subrange, const UseRef& left, const UseRef& right, AttachmentRPInfo& attachment_info, const uint32_t (&families)[2]) {
+		auto [left_batch, right_batch] = use_batches(impl, left, right);
+		auto& src = impl.batches[left_batch];
+		auto& dst = impl.batches[right_batch];
+
+		// renderpasses keep the layout of their own use at the boundary
+		// the attachment view starts at the first mip and layer, the other subranges don't describe it
+		bool describes_attachment = subrange.base_level == 0 && subrange.base_layer == 0;
+		if (left.pass && is_framebuffer_attachment(left.use) && describes_attachment) {
+			auto& left_rp = impl.rpis[left.pass->render_pass_index];
+			auto& rp_att = *contains_if(left_rp.attachments, [id](auto& att) {return att.id == id; });
+			sync_bound_attachment_to_renderpass(rp_att, attachment_info);
+			rp_att.description.finalLayout = (VkImageLayout)left.use.layout;
+			rp_att.description.storeOp = right.use.layout == vuk::ImageLayout::eUndefined ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+		}
+		if (right.pass && is_framebuffer_attachment(right.use) && describes_attachment) {
+			auto& right_rp = impl.rpis[right.pass->render_pass_index];
+			auto& rp_att = *contains_if(right_rp.attachments, [id](auto& att) {return att.id == id; });
+			sync_bound_attachment_to_renderpass(rp_att, attachment_info);
+			rp_att.description.initialLayout = (VkImageLayout)right.use.layout;
+			rp_att.description.loadOp = left.use.layout == vuk::ImageLayout::eUndefined ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+
+		// right layout == Undefined means the chain terminates, nothing to carry over
+		if (right.use.layout == vuk::ImageLayout::eUndefined)
+			return;
+		add_wait(dst, left_batch, right.use.stages);
+
+		bool discard = left.use.layout == vuk::ImageLayout::eUndefined || left.use.layout == vuk::ImageLayout::ePreinitialized;
+		auto src_family = families[(size_t)src.domain];
+		auto dst_family = families[(size_t)dst.domain];
+
+		VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		barrier.oldLayout = discard ? (VkImageLayout)vuk::ImageLayout::eUndefined : (VkImageLayout)left.use.layout;
+		barrier.newLayout = (VkImageLayout)right.use.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange = to_subresource_range(aspect, subrange);
+		if (!discard && src_family != dst_family) {
+			barrier.srcQueueFamilyIndex = src_family;
+			barrier.dstQueueFamilyIndex = dst_family;
+			auto release = barrier;
+			release.srcAccessMask = (VkAccessFlags)left.use.access;
+			release.dstAccessMask = 0;
+			src.release_barriers.push_back(ImageBarrier{ .image = id, .barrier = release, .src = left.use.stages, .dst = vuk::PipelineStageFlagBits::eBottomOfPipe, .src2 = left.use.stages2 });
+		}
+		// the semaphore makes the writes available, the acquire only has to order the transition after the wait
+		if (barrier.oldLayout != barrier.newLayout || barrier.srcQueueFamilyIndex != barrier.dstQueueFamilyIndex) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = (VkAccessFlags)right.use.access;
+			dst.acquire_barriers.push_back(ImageBarrier{ .image = id, .barrier = barrier, .src = right.use.stages, .dst = right.use.stages, .src2 = right.use.stages2, .dst2 = right.use.stages2 });
+		}
+	}
+
+	// a buffer use crossing queues: ordered with a semaphore, ownership is transferred if the queue families differ
+	void link_buffer_across_queues(RGImpl& impl, uint32_t id, const UseRef& left, const UseRef& right, const uint32_t (&families)[2]) {
+		auto [left_batch, right_batch] = use_batches(impl, left, right);
+		auto& src = impl.batches[left_batch];
+		auto& dst = impl.batches[right_batch];
+
+		if (right.use.layout == vuk::ImageLayout::eUndefined)
+			return;
+		add_wait(dst, left_batch, right.use.stages);
+
+		auto src_family = families[(size_t)src.domain];
+		auto dst_family = families[(size_t)dst.domain];
+		if (left.use.layout == vuk::ImageLayout::eUndefined || src_family == dst_family)
+			return;
+
+		// buffer range is filled in when recording
+		VkBufferMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		barrier.srcQueueFamilyIndex = src_family;
+		barrier.dstQueueFamilyIndex = dst_family;
+		auto release = barrier;
+		release.srcAccessMask = (VkAccessFlags)left.use.access;
+		release.dstAccessMask = 0;
+		src.release_buffer_barriers.push_back(BufferBarrier{ .buffer = id, .barrier = release, .src = left.use.stages, .dst = vuk::PipelineStageFlagBits::eBottomOfPipe, .src2 = left.use.stages2 });
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = (VkAccessFlags)right.use.access;
+		dst.acquire_buffer_barriers.push_back(BufferBarrier{ .buffer = id, .barrier = barrier, .src = right.use.stages, .dst = right.use.stages, .src2 = right.use.stages2, .dst2 = right.use.stages2 });
+	}
+
+	// a dependency between framebufferless passes on the same queue, with other passes sorted between them
+	bool is_split_dependency(const RGImpl& impl, const UseRef& left, const UseRef& right) {
+		if (!left.pass || !right.pass)
+			return false;
+		auto& left_rp = impl.rpis[left.pass->render_pass_index];
+		auto& right_rp = impl.rpis[right.pass->render_pass_index];
+		if (!left_rp.framebufferless || !right_rp.framebufferless || left_rp.batch != right_rp.batch)
+			return false;
+		if (left.pass->render_pass_index == right.pass->render_pass_index && left.pass->subpass == right.pass->subpass)
+			return false;
+		return right.pass - left.pass > 1;
+	}
+
+	// the split barrier between the subpasses of left and right, one event per subpass pair
+	SplitBarrier& split_barrier(RGImpl& impl, const UseRef& left, const UseRef& right) {
+		auto& left_sp = impl.rpis[left.pass->render_pass_index].subpasses[left.pass->subpass];
+		auto& right_sp = impl.rpis[right.pass->render_pass_index].subpasses[right.pass->subpass];
+		auto it = std::find_if(right_sp.wait_events.begin(), right_sp.wait_events.end(), [&](auto& sb) { return sb.src_rp == left.pass->render_pass_index && sb.src_subpass == left.pass->subpass; });
+		if (it == right_sp.wait_events.end()) {
+			SplitBarrier sb{ .event = impl.event_count++, .src_rp = left.pass->render_pass_index, .src_subpass = left.pass->subpass };
+			left_sp.set_events.emplace_back(sb.event, vuk::PipelineStageFlags{});
+			it = right_sp.wait_events.insert(right_sp.wait_events.end(), std::move(sb));
+		}
+		auto set = std::find_if(left_sp.set_events.begin(), left_sp.set_events.end(), [&](auto& e) { return e.first == it->event; });
+		set->second |= left.use.stages;
+		it->src |= left.use.stages;
+		it->dst |= right.use.stages;
+		return *it;
+	}
+
+	// whether the sync emitted for an edge orders all later commands in the stages of its right use
+	// dependencies on a subpass from outside or within its renderpass only reach that subpass
+	bool is_global_dst(const RGImpl& impl, const UseRef& left, const UseRef& right) {
+		if (!right.pass || impl.rpis[right.pass->render_pass_index].framebufferless)
+			return true;
+		return left.pass && left.pass->render_pass_index != right.pass->render_pass_index;
+	}
+
+	// whether the sync emitted for an edge waits on all earlier commands in the stages of its left use
+	// dependencies out of a subpass only wait on that subpass, the external dependency into the next renderpass waits on everything
+	bool is_global_src(const RGImpl& impl, const UseRef& left, const UseRef& right) {
+		auto [left_batch, right_batch] = use_batches(impl, left, right);
+		if (impl.batches[left_batch].domain != impl.batches[right_batch].domain || !left.pass)
+			return true;
+		if (impl.rpis[left.pass->render_pass_index].framebufferless)
+			return true;
+		if (!right.pass || right.pass->render_pass_index == left.pass->render_pass_index)
+			return false;
+		return !impl.rpis[right.pass->render_pass_index].framebufferless || !is_framebuffer_attachment(left.use);
+	}
+
+	// which edges of a use chain need sync
+	// reads in the same layout don't depend on each other, so an edge between two such reads is elided when the edge into the
+	// first read of the run already made the resource visible to the stages and accesses of the second
+	// the edge after the run waits on the stages of all its reads, if it can't the run is synced as before
+	std::vector<bool> elide_read_edges(const RGImpl& impl, std::span<UseRef> chain) {
+		auto edges = chain.size() - 1;
+		std::vector<bool> sync(edges, true);
+		size_t head = 0;
+		for (size_t i = 0; i < edges; i++) {
+			auto& left = chain[i];
+			auto& right = chain[i + 1];
+			bool reads = !is_write_access(left.use) && !is_write_access(right.use) && left.use.layout == right.use.layout && left.use.layout != vuk::ImageLayout::eUndefined;
+			if (!reads) {
+				head = i + 1;
+				continue;
+			}
+			if (head == 0 || !is_global_dst(impl, chain[head - 1], chain[head]))
+				continue;
+			auto& first = chain[head].use;
+			auto [first_batch, right_batch] = use_batches(impl, chain[head], right);
+			bool covered = ((VkPipelineStageFlags)right.use.stages & ~(VkPipelineStageFlags)first.stages) == 0 && ((VkAccessFlags)right.use.access & ~(VkAccessFlags)first.access) == 0;
+			sync[i] = !(first_batch == right_batch && covered);
+		}
+
+		for (size_t i = 0; i < edges;) {
+			if (sync[i]) {
+				i++;
+				continue;
+			}
+			size_t end = i;
+			vuk::PipelineStageFlags stages;
+			while (end < edges && !sync[end]) {
+				stages |= chain[end].use.stages;
+				end++;
+			}
+			// nothing after the run: no later write to order
+			if (end < edges) {
+				if (is_global_src(impl, chain[end], chain[end + 1])) {
+					chain[end].use.stages |= stages;
+				} else {
+					std::fill(sync.begin() + i, sync.begin() + end, true);
+				}
+			}
+			i = end;
+		}
+		return sync;
+	}
+
+	// merge the sync generated by link: dependencies between the same subpasses are combined,
+	// as are barriers of the same image subresources with the same layout transition
+	void merge_dependencies(RGImpl& impl) {
+		for (auto& rp : impl.rpis) {
+			auto& deps = rp.rpci.subpass_dependencies;
+			std::vector<VkSubpassDependency> merged;
+			for (auto& sd : deps) {
+				auto it = std::find_if(merged.begin(), merged.end(), [&](auto& m) { return m.srcSubpass == sd.srcSubpass && m.dstSubpass == sd.dstSubpass; });
+				if (it == merged.end()) {
+					merged.push_back(sd);
+					continue;
+				}
+				it->srcStageMask |= sd.srcStageMask;
+				it->dstStageMask |= sd.dstStageMask;
+				it->srcAccessMask |= sd.srcAccessMask;
+				it->dstAccessMask |= sd.dstAccessMask;
+				// a dependency is only framebuffer-local if all merged ones were
+				auto by_region = it->dependencyFlags & sd.dependencyFlags & VK_DEPENDENCY_BY_REGION_BIT;
+				it->dependencyFlags = ((it->dependencyFlags | sd.dependencyFlags) & ~VK_DEPENDENCY_BY_REGION_BIT) | by_region;
+			}
+			deps = std::move(merged);
+
+			auto merge_image_barriers = [](std::vector<ImageBarrier>& barriers) {
+				std::vector<ImageBarrier> merged;
+				for (auto& ib : barriers) {
+					auto it = std::find_if(merged.begin(), merged.end(), [&](auto& m) {
+						auto& a = m.barrier;
+						auto& b = ib.barrier;
+						auto& ar = a.subresourceRange;
+						auto& br = b.subresourceRange;
+						return m.image == ib.image && a.oldLayout == b.oldLayout && a.newLayout == b.newLayout && a.srcQueueFamilyIndex == b.srcQueueFamilyIndex &&
+							a.dstQueueFamilyIndex == b.dstQueueFamilyIndex && ar.aspectMask == br.aspectMask && ar.baseMipLevel == br.baseMipLevel &&
+							ar.levelCount == br.levelCount && ar.baseArrayLayer == br.baseArrayLayer && ar.layerCount == br.layerCount;
+					});
+					if (it == merged.end()) {
+						merged.push_back(ib);
+						continue;
+					}
+					it->barrier.srcAccessMask |= ib.barrier.srcAccessMask;
+					it->barrier.dstAccessMask |= ib.barrier.dstAccessMask;
+					it->src2 = src_stages2(*it) | src_stages2(ib);
+					it->dst2 = dst_stages2(*it) | dst_stages2(ib);
+					it->src |= ib.src;
+					it->dst |= ib.dst;
+				}
+				barriers = std::move(merged);
+			};
+			for (auto& sp : rp.subpasses) {
+				merge_image_barriers(sp.pre_barriers);
+				merge_image_barriers(sp.post_barriers);
+			}
+		}
+	}
+
+	// bind the Context's copies of the history images, rotated once per frame, starting from the use they were left in
+	void bind_histories(PerThreadContext& ptc, RGImpl& impl) {
+		auto& ctx_impl = *ptc.ctx.impl;
+		std::lock_guard _(ctx_impl.histories_lock);
+		for (auto& h : impl.histories) {
+			auto& hi = ctx_impl.histories[std::string(h.name)];
+			auto count = h.versions.size();
+			if (!(hi.ici == h.ici) || hi.images.size() != count) {
+				for (size_t i = 0; i < hi.images.size(); i++) {
+					ptc.destroy(hi.views[i]);
+					ptc.destroy(hi.images[i]);
+				}
+				hi.ici = h.ici;
+				hi.images.clear();
+				hi.views.clear();
+				for (size_t i = 0; i < count; i++) {
+					auto image = ctx_impl.allocator.create_image(h.ici);
+					vuk::ImageViewCreateInfo ivci;
+					ivci.image = image;
+					ivci.format = h.ici.format;
+					ivci.viewType = vuk::ImageViewType::e2D;
+					ivci.subresourceRange = vuk::ImageSubresourceRange{ .aspectMask = format_to_aspect(h.ici.format), .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 };
+					VkImageView iv;
+					vkCreateImageView(ptc.ctx.device, (VkImageViewCreateInfo*)&ivci, nullptr, &iv);
+					ptc.ctx.debug.set_name(image, std::string("Image: History ") + std::string(h.versions[i]));
+					hi.images.push_back(image);
+					hi.views.push_back(ptc.ctx.wrap(iv));
+				}
+				hi.states.assign(count, Resource::Use{ vuk::PipelineStageFlagBits::eTopOfPipe, vuk::AccessFlags{}, vuk::ImageLayout::eUndefined });
+				hi.rotated_frame = ptc.ifc.absolute_frame;
+			} else if (hi.rotated_frame != ptc.ifc.absolute_frame) {
+				// the oldest copy is overwritten by this frame
+				std::rotate(hi.images.rbegin(), hi.images.rbegin() + 1, hi.images.rend());
+				std::rotate(hi.views.rbegin(), hi.views.rbegin() + 1, hi.views.rend());
+				std::rotate(hi.states.rbegin(), hi.states.rbegin() + 1, hi.states.rend());
+				hi.rotated_frame = ptc.ifc.absolute_frame;
+			}
+			for (size_t i = 0; i < count; i++) {
+				auto& att = impl.bound_attachments.at(h.versions[i]);
+				att.image = hi.images[i];
+				att.iv = hi.views[i];
+				att.initial = hi.states[i];
+			}
+		}
+	}
+
+	// remember the use every history copy was left in, copies unused by this graph keep theirs
+	void record_histories(PerThreadContext& ptc, RGImpl& impl) {
+		auto& ctx_impl = *ptc.ctx.impl;
+		std::lock_guard _(ctx_impl.histories_lock);
+		for (auto& h : impl.histories) {
+			auto& hi = ctx_impl.histories.at(std::string(h.name));
+			for (size_t i = 0; i < h.versions.size(); i++) {
+				auto& chain = impl.use_chains[impl.bound_attachments.at(h.versions[i]).id];
+				if (!chain.empty()) {
+					hi.states[i] = chain.back().use;
+				}
+			}
 		}
 	}
 
 	ExecutableRenderGraph RenderGraph::link(vuk::PerThreadContext& ptc)&& {
+		auto& ctx_impl = *ptc.ctx.impl;
+		bind_histories(ptc, *impl);
+		// if we have linked a graph with the same structure before, only rebind callbacks and resources
+		auto key = structure_key(*impl, ptc.ctx.use_dynamic_rendering, ptc.ctx.has_async_compute());
+		auto key_hash = std::hash<std::string>()(key);
+		auto pass_count = impl->passes.size();
+		{
+			std::lock_guard _(ctx_impl.compiled_rgs_lock);
+			auto [begin, end] = ctx_impl.compiled_rgs.equal_range(key_hash);
+			for (auto it = begin; it != end; ++it) {
+				if (it->second->key == key) {
+					it->second->last_use_frame = ptc.ifc.absolute_frame;
+					reuse_compiled(*it->second, *impl);
+					// the structure matched, but this graph's attachments and buffers still have to be checked as on a miss
+					validate();
+					record_histories(ptc, *impl);
+					return { std::move(*this) };
+				}
+			}
+		}
+
 		compile();
 
 		// at this point the graph is built, we know of all the resources and everything should have been attached
 		// perform checking if this indeed the case
 		validate();
 
+		schedule_queues(*impl, ptc.ctx.has_async_compute());
+		const uint32_t families[2] = { ptc.ctx.graphics_queue_family_index, ptc.ctx.compute_queue_family_index };
+
 		for (auto& [raw_name, attachment_info] : impl->bound_attachments) {
-			auto name = resolve_name(raw_name, impl->aliases);
-			auto& chain = impl->use_chains.at(name);
+			auto id = attachment_info.id;
+			auto& chain = impl->use_chains[id];
+			// only used by culled passes
+			if (chain.empty())
+				continue;
+			if (attachment_info.history) {
+				attachment_info.final = chain.back().use;
+			}
 			chain.insert(chain.begin(), UseRef{ std::move(attachment_info.initial), nullptr });
 			chain.emplace_back(UseRef{ attachment_info.final, nullptr });
 
 			vuk::ImageAspectFlags aspect = format_to_aspect((vuk::Format)attachment_info.description.format);
 
-			for (size_t i = 0; i < chain.size() - 1; i++) {
-				auto& left = chain[i];
-				auto& right = chain[i + 1];
+			// images used in parts are linked per subrange, so that barriers only cover the subresources changing state
+			for (auto& [subrange, sub_chain] : subresource_chains(chain)) {
+				// the renderpass binds an attachment through a view starting at the first mip and layer
+				bool describes_attachment = subrange.base_level == 0 && subrange.base_layer == 0;
+				auto sync = elide_read_edges(*impl, sub_chain);
+				// a history copy already in its last use stays there, the next frame syncs with it
+				if (attachment_info.history) {
+					auto& last = sub_chain[sub_chain.size() - 2].use;
+					auto& final = attachment_info.final;
+					if (last.stages == final.stages && last.access == final.access && last.layout == final.layout) {
+						sync.back() = false;
+					}
+				}
+				for (size_t i = 0; i < sub_chain.size() - 1; i++) {
+					auto& left = sub_chain[i];
+					auto& right = sub_chain[i + 1];
 
-				bool crosses_rpass = (left.pass == nullptr || right.pass == nullptr || left.pass->render_pass_index != right.pass->render_pass_index);
-				if (crosses_rpass) {
-					if (left.pass) { // RenderPass ->
-						auto& left_rp = impl->rpis[left.pass->render_pass_index];
-						// if this is an attachment, we specify layout
-						if (is_framebuffer_attachment(left.use)) {
-							assert(!left_rp.framebufferless);
-							auto& rp_att = *contains_if(left_rp.attachments, [name](auto& att) {return att.name == name; });
-
-							sync_bound_attachment_to_renderpass(rp_att, attachment_info);
-							// if there is a "right" rp
-							// or if this attachment has a required end layout
-							// then we transition for it
-							if (right.pass || right.use.layout != vuk::ImageLayout::eUndefined) {
-								rp_att.description.finalLayout = (VkImageLayout)right.use.layout;
-							} else {
-								// we keep last use as finalLayout
-								rp_att.description.finalLayout = (VkImageLayout)left.use.layout;
+					auto [left_batch, right_batch] = use_batches(*impl, left, right);
+					if (impl->batches[left_batch].domain != impl->batches[right_batch].domain) {
+						link_image_across_queues(*impl, id, aspect, subrange, left, right, attachment_info, families);
+						continue;
+					}
+
+					if (sync[i] && is_split_dependency(*impl, left, right)) {
+						VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+						barrier.dstAccessMask = (VkAccessFlags)right.use.access;
+						barrier.srcAccessMask = (VkAccessFlags)left.use.access;
+						barrier.newLayout = (VkImageLayout)right.use.layout;
+						barrier.oldLayout = (VkImageLayout)left.use.layout;
+						barrier.subresourceRange = to_subresource_range(aspect, subrange);
+						ImageBarrier ib{ .image = id, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
+						split_barrier(*impl, left, right).image_barriers.push_back(ib);
+						continue;
+					}
+
+					bool crosses_rpass = (left.pass == nullptr || right.pass == nullptr || left.pass->render_pass_index != right.pass->render_pass_index);
+					if (crosses_rpass) {
+						if (left.pass) { // RenderPass ->
+							auto& left_rp = impl->rpis[left.pass->render_pass_index];
+							// if this is an attachment, we specify layout
+							if (is_framebuffer_attachment(left.use) && describes_attachment) {
+								assert(!left_rp.framebufferless);
+								auto& rp_att = *contains_if(left_rp.attachments, [id](auto& att) {return att.id == id; });
+
+								sync_bound_attachment_to_renderpass(rp_att, attachment_info);
+								// if there is a "right" rp
+								// or if this attachment has a required end layout
+								// then we transition for it
+								if (right.pass || right.use.layout != vuk::ImageLayout::eUndefined) {
+									rp_att.description.finalLayout = (VkImageLayout)right.use.layout;
+								} else {
+									// we keep last use as finalLayout
+									rp_att.description.finalLayout = (VkImageLayout)left.use.layout;
+								}
+								// compute attachment store
+								if (right.use.layout == vuk::ImageLayout::eUndefined) {
+									rp_att.description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+								} else {
+									rp_att.description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+								}
 							}
-							// compute attachment store
-							if (right.use.layout == vuk::ImageLayout::eUndefined) {
-								rp_att.description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-							} else {
-								rp_att.description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+							// reads in the same layout were elided above
+							if (sync[i] && right.use.layout != vuk::ImageLayout::eUndefined && !left_rp.framebufferless) {
+								VkSubpassDependency sd{};
+								sd.dstAccessMask = (VkAccessFlags)right.use.access;
+								sd.dstStageMask = (VkPipelineStageFlags)right.use.stages;
+								sd.srcSubpass = left.pass->subpass;
+								sd.srcAccessMask = (VkAccessFlags)left.use.access;
+								sd.srcStageMask = (VkPipelineStageFlags)left.use.stages;
+								sd.dstSubpass = VK_SUBPASS_EXTERNAL;
+								left_rp.rpci.subpass_dependencies.push_back(sd);
+							}
+							// if we are coming from an fbless pass we need to emit barriers if the right pass doesn't exist (chain end) or has framebuffer 
+							if (sync[i] && left_rp.framebufferless && ((right.pass && !impl->rpis[right.pass->render_pass_index].framebufferless) || right.pass == nullptr)) {
+								// right layout == Undefined means the chain terminates, no transition/barrier
+								if (right.use.layout == vuk::ImageLayout::eUndefined)
+									continue;
+								VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+								barrier.dstAccessMask = (VkAccessFlags)right.use.access;
+								barrier.srcAccessMask = (VkAccessFlags)left.use.access;
+								barrier.newLayout = (VkImageLayout)right.use.layout;
+								barrier.oldLayout = (VkImageLayout)left.use.layout;
+								barrier.subresourceRange = to_subresource_range(aspect, subrange);
+								ImageBarrier ib{ .image = id, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
+								left_rp.subpasses[left.pass->subpass].post_barriers.push_back(ib);
 							}
 						}
-						// TODO: we need a dep here if there is a write or there is a layout transition
-						if (/*left.use.layout != right.use.layout &&*/ right.use.layout != vuk::ImageLayout::eUndefined && !left_rp.framebufferless) { // different layouts, need to have dependency
-							VkSubpassDependency sd{};
-							sd.dstAccessMask = (VkAccessFlags)right.use.access;
-							sd.dstStageMask = (VkPipelineStageFlags)right.use.stages;
-							sd.srcSubpass = left.pass->subpass;
-							sd.srcAccessMask = (VkAccessFlags)left.use.access;
-							sd.srcStageMask = (VkPipelineStageFlags)left.use.stages;
-							sd.dstSubpass = VK_SUBPASS_EXTERNAL;
-							left_rp.rpci.subpass_dependencies.push_back(sd);
-						}
-						// if we are coming from an fbless pass we need to emit barriers if the right pass doesn't exist (chain end) or has framebuffer 
-						if (left_rp.framebufferless && ((right.pass && !impl->rpis[right.pass->render_pass_index].framebufferless) || right.pass == nullptr)) {
-							// right layout == Undefined means the chain terminates, no transition/barrier
-							if (right.use.layout == vuk::ImageLayout::eUndefined)
-								continue;
-							VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-							barrier.dstAccessMask = (VkAccessFlags)right.use.access;
-							barrier.srcAccessMask = (VkAccessFlags)left.use.access;
-							barrier.newLayout = (VkImageLayout)right.use.layout;
-							barrier.oldLayout = (VkImageLayout)left.use.layout;
-							barrier.subresourceRange.aspectMask = (VkImageAspectFlags)aspect;
-							barrier.subresourceRange.baseArrayLayer = 0;
-							barrier.subresourceRange.baseMipLevel = 0;
-							barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-							barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-							ImageBarrier ib{ .image = name, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages };
-							left_rp.subpasses[left.pass->subpass].post_barriers.push_back(ib);
-						}
-					}
 
-					if (right.pass) { // -> RenderPass
-						auto& right_rp = impl->rpis[right.pass->render_pass_index];
-						// if this is an attachment, we specify layout
-						if (is_framebuffer_attachment(right.use)) {
-							assert(!right_rp.framebufferless);
-							auto& rp_att = *contains_if(right_rp.attachments, [name](auto& att) {return att.name == name; });
-
-							sync_bound_attachment_to_renderpass(rp_att, attachment_info);
-							// we will have "left" transition for us
-							if (left.pass) {
-								rp_att.description.initialLayout = (VkImageLayout)right.use.layout;
-							} else {
-								// if there is no "left" renderpass, then we take the initial layout
-								rp_att.description.initialLayout = (VkImageLayout)left.use.layout;
+						if (right.pass) { // -> RenderPass
+							auto& right_rp = impl->rpis[right.pass->render_pass_index];
+							// if this is an attachment, we specify layout
+							if (is_framebuffer_attachment(right.use) && describes_attachment) {
+								assert(!right_rp.framebufferless);
+								auto& rp_att = *contains_if(right_rp.attachments, [id](auto& att) {return att.id == id; });
+
+								sync_bound_attachment_to_renderpass(rp_att, attachment_info);
+								// we will have "left" transition for us
+								if (left.pass) {
+									rp_att.description.initialLayout = (VkImageLayout)right.use.layout;
+								} else {
+									// if there is no "left" renderpass, then we take the initial layout
+									rp_att.description.initialLayout = (VkImageLayout)left.use.layout;
+								}
+								// compute attachment load
+								if (left.use.layout == vuk::ImageLayout::eUndefined) {
+									rp_att.description.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+								} else if (left.use.layout == vuk::ImageLayout::ePreinitialized) {
+									// preinit means clear
+									rp_att.description.initialLayout = (VkImageLayout)vuk::ImageLayout::eUndefined;
+									rp_att.description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+								} else {
+									rp_att.description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+								}
+							}
+							// reads in the same layout were elided above
+							if (sync[i] && left.use.layout != vuk::ImageLayout::eUndefined) {
+								VkSubpassDependency sd{};
+								sd.dstAccessMask = (VkAccessFlags)right.use.access;
+								sd.dstStageMask = (VkPipelineStageFlags)right.use.stages;
+								sd.dstSubpass = right.pass->subpass;
+								sd.srcAccessMask = (VkAccessFlags)left.use.access;
+								sd.srcStageMask = (VkPipelineStageFlags)left.use.stages;
+								sd.srcSubpass = VK_SUBPASS_EXTERNAL;
+								right_rp.rpci.subpass_dependencies.push_back(sd);
 							}
-							// compute attachment load
-							if (left.use.layout == vuk::ImageLayout::eUndefined) {
-								rp_att.description.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-							} else if (left.use.layout == vuk::ImageLayout::ePreinitialized) {
-								// preinit means clear
-								rp_att.description.initialLayout = (VkImageLayout)vuk::ImageLayout::eUndefined;
-								rp_att.description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-							} else {
-								rp_att.description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+							if (sync[i] && right_rp.framebufferless) {
+								if (left.pass) {
+									auto& left_rp = impl->rpis[left.pass->render_pass_index];
+									// if we are coming from a renderpass and this was a framebuffer attachment there
+									// then the renderpass transitioned this resource for us, and we don't need a barrier
+									if (!left_rp.framebufferless && is_framebuffer_attachment(left.use))
+										continue;
+								}
+								VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+								barrier.dstAccessMask = (VkAccessFlags)right.use.access;
+								barrier.srcAccessMask = (VkAccessFlags)left.use.access;
+								barrier.newLayout = (VkImageLayout)right.use.layout;
+								barrier.oldLayout = left.use.layout == vuk::ImageLayout::ePreinitialized ? (VkImageLayout)vuk::ImageLayout::eUndefined : (VkImageLayout)left.use.layout;
+								barrier.subresourceRange = to_subresource_range(aspect, subrange);
+								ImageBarrier ib{ .image = id, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
+								right_rp.subpasses[right.pass->subpass].pre_barriers.push_back(ib);
 							}
+
 						}
-						// TODO: we need a dep here if there is a write or there is a layout transition
-						if (/*right.use.layout != left.use.layout &&*/ left.use.layout != vuk::ImageLayout::eUndefined) { // different layouts, need to have dependency
+					} else { // subpass-subpass link -> subpass - subpass dependency
+						// WAW, WAR, RAW accesses need sync
+
+						// if we merged the passes into a subpass, no sync is needed
+						if (left.pass->subpass == right.pass->subpass)
+							continue;
+						if (sync[i] && is_framebuffer_attachment(left.use) && (is_write_access(left.use) || (is_read_access(left.use) && is_write_access(right.use)))) {
+							assert(left.pass->render_pass_index == right.pass->render_pass_index);
+							auto& rp = impl->rpis[right.pass->render_pass_index];
 							VkSubpassDependency sd{};
 							sd.dstAccessMask = (VkAccessFlags)right.use.access;
 							sd.dstStageMask = (VkPipelineStageFlags)right.use.stages;
 							sd.dstSubpass = right.pass->subpass;
 							sd.srcAccessMask = (VkAccessFlags)left.use.access;
 							sd.srcStageMask = (VkPipelineStageFlags)left.use.stages;
-							sd.srcSubpass = VK_SUBPASS_EXTERNAL;
-							right_rp.rpci.subpass_dependencies.push_back(sd);
-						}
-						if (right_rp.framebufferless) {
-							if (left.pass) {
-								auto& left_rp = impl->rpis[left.pass->render_pass_index];
-								// if we are coming from a renderpass and this was a framebuffer attachment there
-								// then the renderpass transitioned this resource for us, and we don't need a barrier
-								if (!left_rp.framebufferless && is_framebuffer_attachment(left.use))
-									continue;
+							sd.srcSubpass = left.pass->subpass;
+							// both sides only touch the pixel they are at
+							if (is_framebuffer_attachment(right.use)) {
+								sd.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 							}
+							rp.rpci.subpass_dependencies.push_back(sd);
+						}
+						auto& left_rp = impl->rpis[left.pass->render_pass_index];
+						if (sync[i] && left_rp.framebufferless) {
+							// right layout == Undefined means the chain terminates, no transition/barrier
+							if (right.use.layout == vuk::ImageLayout::eUndefined)
+								continue;
 							VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
 							barrier.dstAccessMask = (VkAccessFlags)right.use.access;
 							barrier.srcAccessMask = (VkAccessFlags)left.use.access;
 							barrier.newLayout = (VkImageLayout)right.use.layout;
-							barrier.oldLayout = left.use.layout == vuk::ImageLayout::ePreinitialized ? (VkImageLayout)vuk::ImageLayout::eUndefined : (VkImageLayout)left.use.layout;
-							barrier.subresourceRange.aspectMask = (VkImageAspectFlags)aspect;
-							barrier.subresourceRange.baseArrayLayer = 0;
-							barrier.subresourceRange.baseMipLevel = 0;
-							barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-							barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-							ImageBarrier ib{ .image = name, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages };
-							right_rp.subpasses[right.pass->subpass].pre_barriers.push_back(ib);
+							barrier.oldLayout = (VkImageLayout)left.use.layout;
+							barrier.subresourceRange = to_subresource_range(aspect, subrange);
+							ImageBarrier ib{ .image = id, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
+							left_rp.subpasses[left.pass->subpass].post_barriers.push_back(ib);
 						}
-
-					}
-				} else { // subpass-subpass link -> subpass - subpass dependency
-					// WAW, WAR, RAW accesses need sync
-
-					// if we merged the passes into a subpass, no sync is needed
-					if (left.pass->subpass == right.pass->subpass)
-						continue;
-					if (is_framebuffer_attachment(left.use) && (is_write_access(left.use) || (is_read_access(left.use) && is_write_access(right.use)))) {
-						assert(left.pass->render_pass_index == right.pass->render_pass_index);
-						auto& rp = impl->rpis[right.pass->render_pass_index];
-						VkSubpassDependency sd{};
-						sd.dstAccessMask = (VkAccessFlags)right.use.access;
-						sd.dstStageMask = (VkPipelineStageFlags)right.use.stages;
-						sd.dstSubpass = right.pass->subpass;
-						sd.srcAccessMask = (VkAccessFlags)left.use.access;
-						sd.srcStageMask = (VkPipelineStageFlags)left.use.stages;
-						sd.srcSubpass = left.pass->subpass;
-						rp.rpci.subpass_dependencies.push_back(sd);
-					}
-					auto& left_rp = impl->rpis[left.pass->render_pass_index];
-					if (left_rp.framebufferless) {
-						// right layout == Undefined means the chain terminates, no transition/barrier
-						if (right.use.layout == vuk::ImageLayout::eUndefined)
-							continue;
-						VkImageMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-						barrier.dstAccessMask = (VkAccessFlags)right.use.access;
-						barrier.srcAccessMask = (VkAccessFlags)left.use.access;
-						barrier.newLayout = (VkImageLayout)right.use.layout;
-						barrier.oldLayout = (VkImageLayout)left.use.layout;
-						barrier.subresourceRange.aspectMask = (VkImageAspectFlags)aspect;
-						barrier.subresourceRange.baseArrayLayer = 0;
-						barrier.subresourceRange.baseMipLevel = 0;
-						barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-						barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-						ImageBarrier ib{ .image = name, .barrier = barrier, .src = left.use.stages, .dst = right.use.stages };
-						left_rp.subpasses[left.pass->subpass].post_barriers.push_back(ib);
 					}
 				}
 			}
 		}
 
 		for (auto& [raw_name, buffer_info] : impl->bound_buffers) {
-			auto name = resolve_name(raw_name, impl->aliases);
-			auto& chain = impl->use_chains.at(name);
+			auto id = buffer_info.id;
+			auto& chain = impl->use_chains[id];
+			// only used by culled passes
+			if (chain.empty())
+				continue;
 			chain.insert(chain.begin(), UseRef{ std::move(buffer_info.initial), nullptr });
 			chain.emplace_back(UseRef{ buffer_info.final, nullptr });
 
-			for (size_t i = 0; i < chain.size() - 1; i++) {
-				auto& left = chain[i];
-				auto& right = chain[i + 1];
+			// elision widens stages, keep the stored chain intact
+			std::vector<UseRef> sync_chain(chain.begin(), chain.end());
+			auto sync = elide_read_edges(*impl, sync_chain);
+			for (size_t i = 0; i < sync_chain.size() - 1; i++) {
+				auto& left = sync_chain[i];
+				auto& right = sync_chain[i + 1];
+
+				auto [left_batch, right_batch] = use_batches(*impl, left, right);
+				if (impl->batches[left_batch].domain != impl->batches[right_batch].domain) {
+					link_buffer_across_queues(*impl, id, left, right, families);
+					continue;
+				}
+
+				if (!sync[i])
+					continue;
+
+				if (is_split_dependency(*impl, left, right)) {
+					VkMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+					barrier.dstAccessMask = (VkAccessFlags)right.use.access;
+					barrier.srcAccessMask = (VkAccessFlags)left.use.access;
+					MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
+					split_barrier(*impl, left, right).mem_barriers.push_back(mb);
+					continue;
+				}
 
 				bool crosses_rpass = (left.pass == nullptr || right.pass == nullptr || left.pass->render_pass_index != right.pass->render_pass_index);
 				if (crosses_rpass) {
@@ -489,7 +1619,7 @@ namespace vuk {
 						VkMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER };
 						barrier.dstAccessMask = (VkAccessFlags)right.use.access;
 						barrier.srcAccessMask = (VkAccessFlags)left.use.access;
-						MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages };
+						MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
 						left_rp.subpasses[left.pass->subpass].post_mem_barriers.push_back(mb);
 					}
 
@@ -499,7 +1629,7 @@ namespace vuk {
 						VkMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER };
 						barrier.dstAccessMask = (VkAccessFlags)right.use.access;
 						barrier.srcAccessMask = (VkAccessFlags)left.use.access;
-						MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages };
+						MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
 						if (mb.src == vuk::PipelineStageFlags{}) {
 							mb.src = vuk::PipelineStageFlagBits::eTopOfPipe;
 							mb.barrier.srcAccessMask = {};
@@ -514,17 +1644,19 @@ namespace vuk {
 						VkMemoryBarrier barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER };
 						barrier.dstAccessMask = (VkAccessFlags)right.use.access;
 						barrier.srcAccessMask = (VkAccessFlags)left.use.access;
-						MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages };
+						MemoryBarrier mb{ .barrier = barrier, .src = left.use.stages, .dst = right.use.stages, .src2 = left.use.stages2, .dst2 = right.use.stages2 };
 						left_rp.subpasses[left.pass->subpass].post_mem_barriers.push_back(mb);
 					}
 				}
 			}
 		}
 
+		merge_dependencies(*impl);
 
 		for (auto& rp : impl->rpis) {
 			rp.rpci.color_ref_offsets.resize(rp.subpasses.size());
 			rp.rpci.ds_refs.resize(rp.subpasses.size());
+			rp.rpci.input_ref_offsets.resize(rp.subpasses.size());
 		}
 
 		// we now have enough data to build vk::RenderPasses and vk::Framebuffers
@@ -555,12 +1687,25 @@ namespace vuk {
 					continue;
 				VkAttachmentReference attref{};
 
-				auto name = resolve_name(res.name, impl->aliases);
-				auto& chain = impl->use_chains.find(name)->second;
+				auto& chain = impl->use_chains[res.id];
 				auto cit = std::find_if(chain.begin(), chain.end(), [&](auto& useref) { return useref.pass == &pass; });
 				assert(cit != chain.end());
 				attref.layout = (VkImageLayout)cit->use.layout;
-				attref.attachment = (uint32_t)std::distance(rp.attachments.begin(), std::find_if(rp.attachments.begin(), rp.attachments.end(), [&](auto& att) { return name == att.name; }));
+				attref.attachment = (uint32_t)std::distance(rp.attachments.begin(), std::find_if(rp.attachments.begin(), rp.attachments.end(), [&](auto& att) { return res.id == att.id; }));
+
+				if (res.ia == vuk::Access::eInputRead) {
+					auto& input_attrefs = rp.rpci.input_refs;
+					auto& input_ref_offsets = rp.rpci.input_ref_offsets;
+					if (subpass_index < rp.subpasses.size() - 1) {
+						input_attrefs.insert(input_attrefs.begin() + input_ref_offsets[subpass_index + 1], attref);
+					} else {
+						input_attrefs.push_back(attref);
+					}
+					for (size_t i = subpass_index + 1; i < rp.subpasses.size(); i++) {
+						input_ref_offsets[i]++;
+					}
+					continue;
+				}
 
 				if (attref.layout != (VkImageLayout)vuk::ImageLayout::eColorAttachmentOptimal) {
 					if (attref.layout == (VkImageLayout)vuk::ImageLayout::eDepthStencilAttachmentOptimal) {
@@ -604,6 +1749,41 @@ namespace vuk {
 			auto& color_ref_offsets = rp.rpci.color_ref_offsets;
 			auto& resolve_attrefs = rp.rpci.resolve_refs;
 			auto& ds_attrefs = rp.rpci.ds_refs;
+			auto& input_attrefs = rp.rpci.input_refs;
+			auto& input_ref_offsets = rp.rpci.input_ref_offsets;
+
+			auto ref_range = [&](const auto& refs, const std::vector<size_t>& offsets, size_t i) {
+				size_t end = i < rp.subpasses.size() - 1 ? offsets[i + 1] : refs.size();
+				return std::span(refs.data() + offsets[i], end - offsets[i]);
+			};
+
+			// attachments not used by a subpass but used before and after it have to be preserved through it
+			std::vector<std::vector<bool>> used(rp.subpasses.size(), std::vector<bool>(rp.attachments.size()));
+			for (size_t i = 0; i < rp.subpasses.size(); i++) {
+				auto mark = [&](const VkAttachmentReference& ref) {
+					if (ref.attachment != VK_ATTACHMENT_UNUSED) {
+						used[i][ref.attachment] = true;
+					}
+				};
+				for (auto& ref : ref_range(color_attrefs, color_ref_offsets, i)) mark(ref);
+				for (auto& ref : ref_range(resolve_attrefs, color_ref_offsets, i)) mark(ref);
+				for (auto& ref : ref_range(input_attrefs, input_ref_offsets, i)) mark(ref);
+				if (ds_attrefs[i]) mark(*ds_attrefs[i]);
+			}
+			rp.rpci.preserve_ref_offsets.resize(rp.subpasses.size());
+			for (size_t i = 0; i < rp.subpasses.size(); i++) {
+				rp.rpci.preserve_ref_offsets[i] = rp.rpci.preserve_refs.size();
+				for (uint32_t a = 0; a < rp.attachments.size(); a++) {
+					if (used[i][a])
+						continue;
+					bool before = false, after = false;
+					for (size_t j = 0; j < i; j++) before |= used[j][a];
+					for (size_t j = i + 1; j < rp.subpasses.size(); j++) after |= used[j][a];
+					if (before && after) {
+						rp.rpci.preserve_refs.push_back(a);
+					}
+				}
+			}
 
 			// subpasses
 			for (size_t i = 0; i < rp.subpasses.size(); i++) {
@@ -622,11 +1802,17 @@ namespace vuk {
 
 				sd.pDepthStencilAttachment = ds_attrefs[i] ? &*ds_attrefs[i] : nullptr;
 				sd.flags = {};
-				sd.inputAttachmentCount = 0;
-				sd.pInputAttachments = nullptr;
+				{
+					auto inputs = ref_range(input_attrefs, input_ref_offsets, i);
+					sd.inputAttachmentCount = (uint32_t)inputs.size();
+					sd.pInputAttachments = inputs.data();
+				}
 				sd.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-				sd.preserveAttachmentCount = 0;
-				sd.pPreserveAttachments = nullptr;
+				{
+					auto preserves = ref_range(rp.rpci.preserve_refs, rp.rpci.preserve_ref_offsets, i);
+					sd.preserveAttachmentCount = (uint32_t)preserves.size();
+					sd.pPreserveAttachments = preserves.data();
+				}
 				{
 					auto first = resolve_attrefs.data() + color_ref_offsets[i];
 					sd.pResolveAttachments = first;
@@ -644,7 +1830,7 @@ namespace vuk {
 			// attachments
 			vuk::Samples samples(vuk::SampleCountFlagBits::e1);
 			for (auto& attrpinfo : rp.attachments) {
-				auto& bound = impl->bound_attachments.at(attrpinfo.name);
+				auto& bound = *impl->attachment_slots[attrpinfo.id];
 				if (!bound.samples.infer) {
 					samples = bound.samples;
 				}
@@ -655,20 +1841,50 @@ namespace vuk {
 				} else {
 					attrpinfo.description.samples = (VkSampleCountFlagBits)attrpinfo.samples.count;
 				}
+				// stencil follows depth, so that discarded depth-stencil attachments are not loaded or stored either
+				if (format_to_aspect((vuk::Format)attrpinfo.description.format) & vuk::ImageAspectFlagBits::eStencil) {
+					attrpinfo.description.stencilLoadOp = attrpinfo.description.loadOp;
+					attrpinfo.description.stencilStoreOp = attrpinfo.description.storeOp;
+				} else {
+					attrpinfo.description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					attrpinfo.description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				}
 				rp.rpci.attachments.push_back(attrpinfo.description);
 			}
 
 			rp.rpci.attachmentCount = (uint32_t)rp.rpci.attachments.size();
 			rp.rpci.pAttachments = rp.rpci.attachments.data();
 
-			rp.handle = ptc.acquire_renderpass(rp.rpci);
+			// subpasses (and so input attachments) need a renderpass object
+			assert((!ptc.ctx.use_dynamic_rendering || ptc.ctx.cmdBeginRenderingKHR) && "use_dynamic_rendering needs VK_KHR_dynamic_rendering");
+			rp.dynamic_rendering = ptc.ctx.use_dynamic_rendering && rp.subpasses.size() == 1 && rp.rpci.input_refs.empty();
+			if (rp.dynamic_rendering) {
+				lower_to_barriers(rp);
+			} else {
+				rp.handle = ptc.acquire_renderpass(rp.rpci);
+			}
+		}
+
+		auto compiled = std::make_unique<CompiledRenderGraph>();
+		store_compiled(*impl, *compiled);
+		compiled->pass_count = pass_count;
+		compiled->key = std::move(key);
+		compiled->last_use_frame = ptc.ifc.absolute_frame;
+		{
+			std::lock_guard _(ctx_impl.compiled_rgs_lock);
+			ctx_impl.compiled_rgs.emplace(key_hash, std::move(compiled));
 		}
 
+		record_histories(ptc, *impl);
 		return { std::move(*this) };
 	}
 
 	MapProxy<Name, std::span<const UseRef>> RenderGraph::get_use_chains() {
-		return &impl->use_chains;
+		return impl;
+	}
+
+	std::span<const Name> RenderGraph::get_culled_passes() {
+		return impl->culled_passes;
 	}
 
 	MapProxy<Name, const AttachmentRPInfo&> RenderGraph::get_bound_attachments() {
@@ -682,7 +1898,7 @@ namespace vuk {
 			case vuk::ImageLayout::eDepthStencilAttachmentOptimal:
 				usage |= vuk::ImageUsageFlagBits::eDepthStencilAttachment; break;
 			case vuk::ImageLayout::eShaderReadOnlyOptimal: // TODO: more complex analysis
-				usage |= vuk::ImageUsageFlagBits::eSampled; break;
+				usage |= is_input_attachment(c.use) ? vuk::ImageUsageFlagBits::eInputAttachment : vuk::ImageUsageFlagBits::eSampled; break;
 			case vuk::ImageLayout::eColorAttachmentOptimal:
 				usage |= vuk::ImageUsageFlagBits::eColorAttachment; break;
 			case vuk::ImageLayout::eTransferSrcOptimal:
@@ -2,32 +2,127 @@
 
 #include <vuk/ShortAlloc.hpp>
 #include <robin_hood.h>
+#include <deque>
+#include <string>
 #include "RenderGraphUtil.hpp"
+#include "vuk/Context.hpp"
 
 namespace vuk {
 #define INIT(x) x(decltype(x)::allocator_type(*arena_))
+	using UseChain = std::vector<UseRef, short_alloc<UseRef, 64>>;
+
+	// gives the arena back to the Context it was acquired from, or frees it if it was not
+	// as the deleter of the first member, it runs after everything allocated from the arena is gone
+	struct ArenaRecycler {
+		struct ContextImpl* owner = nullptr;
+
+		void operator()(arena* a) const noexcept;
+	};
+
+	// queries of a profiled execution and what they measure, read back when the frame comes around again
+	// scope s owns the timestamps 2s and 2s + 1, and the statistics query s
+	struct ProfiledExecution {
+		VkQueryPool timestamps = VK_NULL_HANDLE;
+		VkQueryPool statistics = VK_NULL_HANDLE;
+		VkQueryPipelineStatisticFlags statistics_flags = 0;
+		uint32_t scope_count = 0;
+
+		struct Scope {
+			uint32_t index;
+			GPUTiming::Kind kind;
+			std::string name;
+		};
+		std::vector<Scope> scopes;
+	};
+
 	struct RGImpl {
-		std::unique_ptr<arena> arena_;
+		std::unique_ptr<arena, ArenaRecycler> arena_;
 		std::vector<PassInfo> passes;
+		// sorted pass -> index of the pass in add order
+		std::vector<uint32_t> pass_order;
+		// names of the passes removed by compile
+		std::vector<Name> culled_passes;
 
 		robin_hood::unordered_flat_map<Name, Name> aliases;
 
+		// every name seen by compile (aliases included) -> dense id of the resource it resolves to
+		// the structures below are indexed by these ids, names are only kept for debugging and the name-based API
+		robin_hood::unordered_flat_map<Name, uint32_t> resource_ids;
+		// id -> resolved name
+		std::vector<Name> resource_names;
+
 		robin_hood::unordered_flat_set<Resource> global_inputs;
 		robin_hood::unordered_flat_set<Resource> global_outputs;
 
-		robin_hood::unordered_flat_map<Name, std::vector<UseRef, short_alloc<UseRef, 64>>> use_chains;
+		// id -> uses of the resource, empty for resources no pass uses
+		std::vector<UseChain> use_chains;
 
 		std::vector<RenderPassInfo, short_alloc<RenderPassInfo, 64>> rpis;
+		std::vector<QueueBatch> batches;
+		// number of events used by split barriers, and the events acquired for an execution
+		size_t event_count = 0;
+		std::vector<VkEvent> events;
+		// views of the image subranges used by passes, created for an execution
+		struct SubrangeView {
+			uint32_t id;
+			Resource::Subrange subrange;
+			Unique<ImageView> view;
+		};
+		std::vector<SubrangeView> subrange_views;
+
+		// set by ExecutableRenderGraph::enable_profiling
+		bool profiling = false;
+		VkQueryPipelineStatisticFlags profiled_statistics = 0;
+		// scopes of the execution being recorded, while profiling
+		struct Profiler* profiler = nullptr;
+
+		// set by ExecutableRenderGraph::split_submissions, 0 records each queue batch into one command buffer
+		size_t renderpasses_per_submission = 0;
+		std::function<void(Domain, const VkSubmitInfo&)> submit;
+		// set by ExecutableRenderGraph::wait_for_swapchain
+		VkSemaphore swapchain_semaphore = VK_NULL_HANDLE;
+		vuk::PipelineStageFlags swapchain_wait_stages;
+
+		// images attached with attach_history, bound to the Context's copies by link
+		struct History {
+			Name name;
+			ImageCreateInfo ici;
+			// name of each copy, the i-th is i frames old
+			std::vector<Name> versions;
+		};
+		std::vector<History> histories;
+		// generated names of the older copies
+		std::vector<std::unique_ptr<std::string>> owned_names;
 
 		robin_hood::unordered_flat_map<Name, AttachmentRPInfo> bound_attachments;
 		robin_hood::unordered_flat_map<Name, BufferInfo> bound_buffers;
+		// id -> attached resource, null if not attached
+		// pointers into the maps above, valid once compile has stopped adding and removing attachments
+		std::vector<AttachmentRPInfo*> attachment_slots;
+		std::vector<BufferInfo*> buffer_slots;
 
 		RGImpl() : arena_(new arena(1024 * 128)), INIT(rpis) {
 			passes.reserve(64);
 		}
+
+		RGImpl(std::unique_ptr<arena, ArenaRecycler> a) : arena_(std::move(a)), INIT(rpis) {
+			passes.reserve(64);
+		}
 	};
 #undef INIT
 
+	// compiled products of a RenderGraph, reused by link() for graphs with the same structure
+	struct CompiledRenderGraph {
+		// passes carry no callbacks, all names point into `names`
+		RGImpl impl;
+		std::deque<std::string> names;
+		// number of passes before culling
+		size_t pass_count = 0;
+		// structure_key of the graph, compared on lookup
+		std::string key;
+		size_t last_use_frame = 0;
+	};
+
 	template<class T, class A, class F>
 	T* contains_if(std::vector<T, A>& v, F&& f) {
 		auto it = std::find_if(v.begin(), v.end(), f);
@@ -49,14 +144,6 @@ namespace vuk {
 		else return nullptr;
 	}
 
-	template <typename Iterator, typename Compare>
-	void topological_sort(Iterator begin, Iterator end, Compare cmp) {
-		while (begin != end) {
-			auto const new_begin = std::partition(begin, end, [&](auto const& a) {
-				return std::none_of(begin, end, [&](auto const& b) { return cmp(b, a); });
-				});
-			assert(new_begin != begin && "not a partial ordering");
-			begin = new_begin;
-		}
-	}
+	// order passes so that every producer precedes its consumers, ties broken by auxiliary_order
+	std::vector<uint32_t> topological_sort(std::vector<PassInfo>& passes, size_t resource_count);
 };
\ No newline at end of file
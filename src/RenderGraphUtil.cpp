@@ -1,15 +1,16 @@
 #include "vuk/RenderGraph.hpp"
 #include "RenderGraphImpl.hpp"
 #include "RenderGraphUtil.hpp"
+#include <algorithm>
 
 namespace vuk {
 	namespace detail {
 		Resource ImageResource::operator()(Access ia) {
-			return Resource{ name, Resource::Type::eImage, ia };
+			return Resource{ name, hash_name, Resource::Type::eImage, ia };
 		}
 
 		Resource BufferResource::operator()(Access ba) {
-			return Resource{ name, Resource::Type::eBuffer, ba };
+			return Resource{ name, hash_name, Resource::Type::eBuffer, ba };
 		}
 	}
 
@@ -27,60 +28,77 @@ namespace vuk {
 	// implement MapProxy for relevant types
 
 	// implement MapProxy for UseRefs
+	// use chains are stored by resource id, the proxy iterates the non-empty ones by name
 	using MP1 = MapProxy<Name, std::span<const UseRef>>;
 	using MPI1 = ConstMapIterator<Name, std::span<const UseRef>>;
-	using M1 = robin_hood::unordered_flat_map<Name, std::vector<UseRef, short_alloc<UseRef, 64>>>;
+
+	struct UseChainIterator {
+		const RGImpl* impl;
+		size_t id;
+
+		void skip_empty() {
+			while (id < impl->use_chains.size() && impl->use_chains[id].empty())
+				id++;
+		}
+	};
 
 	template<>
 	MP1::const_iterator MP1::cbegin() const noexcept {
-		auto& map = *reinterpret_cast<M1*>(_map);
-		return MP1::const_iterator(new M1::const_iterator(map.cbegin()));
+		auto& impl = *reinterpret_cast<RGImpl*>(_map);
+		auto it = new UseChainIterator{ &impl, 0 };
+		it->skip_empty();
+		return MP1::const_iterator(it);
 	}
 
 	template<>
 	MP1::const_iterator MP1::cend() const noexcept {
-		auto& map = *reinterpret_cast<M1*>(_map);
-		return MP1::const_iterator(new M1::const_iterator(map.cend()));
+		auto& impl = *reinterpret_cast<RGImpl*>(_map);
+		return MP1::const_iterator(new UseChainIterator{ &impl, impl.use_chains.size() });
 	}
 
 	template<>
 	MP1::const_iterator MP1::find(Name key) const noexcept {
-		auto& map = *reinterpret_cast<M1*>(_map);
-		return MP1::const_iterator(new M1::const_iterator(map.find(key)));
+		auto& impl = *reinterpret_cast<RGImpl*>(_map);
+		auto it = impl.resource_ids.find(key);
+		if (it == impl.resource_ids.end() || impl.use_chains[it->second].empty())
+			return cend();
+		return MP1::const_iterator(new UseChainIterator{ &impl, it->second });
 	}
 
 	template<>
 	size_t MP1::size() const noexcept {
-		auto& map = *reinterpret_cast<M1*>(_map);
-		return map.size();
+		auto& impl = *reinterpret_cast<RGImpl*>(_map);
+		return std::count_if(impl.use_chains.begin(), impl.use_chains.end(), [](auto& chain) { return !chain.empty(); });
 	}
 
 	template<>
 	MPI1::~ConstMapIterator() {
-		delete reinterpret_cast<M1::const_iterator*>(_iter);
+		delete reinterpret_cast<UseChainIterator*>(_iter);
 	}
 
 	template<>
 	MPI1::ConstMapIterator(const MPI1& other) noexcept {
-		*reinterpret_cast<M1::const_iterator*>(_iter) = *reinterpret_cast<M1::iterator*>(other._iter);
+		_iter = new UseChainIterator(*reinterpret_cast<UseChainIterator*>(other._iter));
 	}
 
 	template<>
 	MPI1::reference MPI1::operator*() noexcept {
-		const auto& iter = *reinterpret_cast<M1::const_iterator const*>(_iter);
-		std::pair<const Name&, std::span<const UseRef>> result(iter->first, std::span(iter->second));
+		const auto& iter = *reinterpret_cast<UseChainIterator const*>(_iter);
+		std::pair<const Name&, std::span<const UseRef>> result(iter.impl->resource_names[iter.id], std::span(iter.impl->use_chains[iter.id]));
 		return result;
 	}
 
 	template<>
 	MPI1& MPI1::operator++() noexcept {
-		reinterpret_cast<M1::iterator*>(_iter)->operator++();
+		auto& iter = *reinterpret_cast<UseChainIterator*>(_iter);
+		iter.id++;
+		iter.skip_empty();
 		return *this;
 	}
 
 	template<>
 	bool MPI1::operator==(MPI1 const& other) const noexcept {
-		return *reinterpret_cast<M1::iterator const*>(_iter) == *reinterpret_cast<M1::iterator const*>(other._iter);
+		return reinterpret_cast<UseChainIterator const*>(_iter)->id == reinterpret_cast<UseChainIterator const*>(other._iter)->id;
 	}
 
 
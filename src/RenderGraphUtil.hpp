@@ -9,6 +9,14 @@ namespace std {
 			return s.hash_name;
 		}
 	};
+
+	template<> struct hash<vuk::Resource::Use> {
+		std::size_t operator()(vuk::Resource::Use const& s) const noexcept {
+			size_t h = 0;
+			hash_combine(h, (VkPipelineStageFlags)s.stages, (VkAccessFlags)s.access, s.layout);
+			return h;
+		}
+	};
 }
 
 namespace vuk {
@@ -36,6 +44,7 @@ namespace vuk {
 		switch (ia) {
 		case eColorResolveRead:
 		case eColorRead:
+		case eInputRead:
 		case eColorRW:
 		case eDepthStencilRead:
 		case eDepthStencilRW:
@@ -55,6 +64,18 @@ namespace vuk {
 		}
 	}
 
+	inline bool is_compute_access(Access ia) {
+		switch (ia) {
+		case eComputeRead:
+		case eComputeWrite:
+		case eComputeRW:
+		case eComputeSampled:
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	inline Resource::Use to_use(Access ia) {
 		switch (ia) {
 		case eColorResolveWrite:
@@ -63,19 +84,21 @@ namespace vuk {
 		case eColorResolveRead:
 		case eColorRead: return { vuk::PipelineStageFlagBits::eColorAttachmentOutput, vuk::AccessFlagBits::eColorAttachmentRead, vuk::ImageLayout::eColorAttachmentOptimal };
 		case eDepthStencilRW: return { vuk::PipelineStageFlagBits::eEarlyFragmentTests | vuk::PipelineStageFlagBits::eLateFragmentTests, vuk::AccessFlagBits::eDepthStencilAttachmentRead | vuk::AccessFlagBits::eDepthStencilAttachmentWrite, vuk::ImageLayout::eDepthStencilAttachmentOptimal };
+		case eInputRead: return { vuk::PipelineStageFlagBits::eFragmentShader, vuk::AccessFlagBits::eInputAttachmentRead, vuk::ImageLayout::eShaderReadOnlyOptimal };
 
 		case eFragmentSampled: return { vuk::PipelineStageFlagBits::eFragmentShader, vuk::AccessFlagBits::eShaderRead, vuk::ImageLayout::eShaderReadOnlyOptimal };
 		case eFragmentRead: return { vuk::PipelineStageFlagBits::eFragmentShader, vuk::AccessFlagBits::eShaderRead, vuk::ImageLayout::eShaderReadOnlyOptimal };
 
-		case eTransferSrc: return { vuk::PipelineStageFlagBits::eTransfer, vuk::AccessFlagBits::eTransferRead, vuk::ImageLayout::eTransferSrcOptimal };
-		case eTransferDst: return { vuk::PipelineStageFlagBits::eTransfer, vuk::AccessFlagBits::eTransferWrite, vuk::ImageLayout::eTransferDstOptimal };
+		// copies, blits and resolves, but not clears
+		case eTransferSrc: return { vuk::PipelineStageFlagBits::eTransfer, vuk::AccessFlagBits::eTransferRead, vuk::ImageLayout::eTransferSrcOptimal, VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR | VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR };
+		case eTransferDst: return { vuk::PipelineStageFlagBits::eTransfer, vuk::AccessFlagBits::eTransferWrite, vuk::ImageLayout::eTransferDstOptimal, VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR | VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR };
 
 		case eComputeRead: return { vuk::PipelineStageFlagBits::eComputeShader, vuk::AccessFlagBits::eShaderRead, vuk::ImageLayout::eGeneral };
 		case eComputeWrite: return { vuk::PipelineStageFlagBits::eComputeShader, vuk::AccessFlagBits::eShaderWrite, vuk::ImageLayout::eGeneral };
 		case eComputeRW: return { vuk::PipelineStageFlagBits::eComputeShader, vuk::AccessFlagBits::eShaderRead | vuk::AccessFlagBits::eShaderWrite, vuk::ImageLayout::eGeneral };
 		case eComputeSampled: return { vuk::PipelineStageFlagBits::eComputeShader, vuk::AccessFlagBits::eShaderRead, vuk::ImageLayout::eShaderReadOnlyOptimal };
 
-		case eAttributeRead: return { vuk::PipelineStageFlagBits::eVertexInput, vuk::AccessFlagBits::eVertexAttributeRead, vuk::ImageLayout::eGeneral /* ignored */ };
+		case eAttributeRead: return { vuk::PipelineStageFlagBits::eVertexInput, vuk::AccessFlagBits::eVertexAttributeRead, vuk::ImageLayout::eGeneral /* ignored */, VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR };
 
 		case eHostRead:
 			return { vuk::PipelineStageFlagBits::eHost, vuk::AccessFlagBits::eHostRead, vuk::ImageLayout::eGeneral };
@@ -93,7 +116,7 @@ namespace vuk {
 		case eClear:
 			return { vuk::PipelineStageFlagBits::eColorAttachmentOutput, vuk::AccessFlagBits::eColorAttachmentWrite, vuk::ImageLayout::ePreinitialized };
 		case eTransferClear:
-			return { vuk::PipelineStageFlagBits::eTransfer, vuk::AccessFlagBits::eTransferWrite, vuk::ImageLayout::eTransferDstOptimal };
+			return { vuk::PipelineStageFlagBits::eTransfer, vuk::AccessFlagBits::eTransferWrite, vuk::ImageLayout::eTransferDstOptimal, VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR };
 		default:
 			assert(0 && "NYI");
 			return {};
@@ -111,13 +134,21 @@ namespace vuk {
 		case eDepthStencilRead:
 		case eColorResolveRead:
 		case eColorResolveWrite:
+		case eInputRead:
 			return true;
 		default:
 			return false;
 		}
 	}
 
+	inline bool is_input_attachment(Resource::Use u) {
+		return (bool)(u.access & vuk::AccessFlagBits::eInputAttachmentRead);
+	}
+
+	// input attachments are bound through the framebuffer too
 	inline bool is_framebuffer_attachment(Resource::Use u) {
+		if (is_input_attachment(u))
+			return true;
 		switch (u.layout) {
 		case vuk::ImageLayout::eColorAttachmentOptimal:
 		case vuk::ImageLayout::eDepthStencilAttachmentOptimal:
@@ -133,7 +164,7 @@ namespace vuk {
 		if (u.access & vuk::AccessFlagBits::eShaderWrite) return true;
 		if (u.access & vuk::AccessFlagBits::eTransferWrite) return true;
 		if (u.access & vuk::AccessFlagBits::eHostWrite) return true;
-		assert(0 && "NYI");
+		if (u.access & vuk::AccessFlagBits::eMemoryWrite) return true;
 		return false;
 	}
 
@@ -144,6 +175,7 @@ namespace vuk {
 	struct UseRef {
 		Resource::Use use;
 		PassInfo* pass = nullptr;
+		Resource::Subrange subrange;
 	};
 
 	template<class T>
@@ -171,6 +203,9 @@ namespace vuk {
 
 		bool is_head_pass = false;
 		bool is_tail_pass = false;
+
+		// passes only doing compute work can go on the compute queue
+		Domain domain = Domain::eGraphics;
 	};
 
 	struct AttachmentSInfo {
@@ -181,6 +216,8 @@ namespace vuk {
 
 	struct AttachmentRPInfo {
 		Name name;
+		// id of the resolved name, assigned by compile
+		uint32_t id = UINT32_MAX;
 
 		vuk::Dimension2D extents;
 		vuk::Samples samples;
@@ -195,34 +232,99 @@ namespace vuk {
 
 		vuk::ImageView iv;
 		vuk::Image image = {};
+		// mip level and array layer iv starts at
+		uint32_t base_level = 0;
+		uint32_t base_layer = 0;
 		// swapchain for swapchain
 		Swapchain* swapchain;
 
 		// optionally set
 		bool should_clear = false;
 		Clear clear_value;
+
+		// copy of a history image: it is left in its last use, which the next frame starts from
+		bool history = false;
 	};
 
 	struct BufferInfo {
 		Name name;
+		// id of the resolved name, assigned by compile
+		uint32_t id = UINT32_MAX;
 
 		Resource::Use initial;
 		Resource::Use final;
 
 		vuk::Buffer buffer;
+
+		// buffers created by the rendergraph are allocated for every execution
+		bool managed = false;
+		size_t size = 0;
+		vuk::BufferUsageFlags usage;
 	};
 
+	// src2 and dst2 are the synchronization2 stages when finer than src and dst, 0 if the same
 	struct ImageBarrier {
-		Name image;
+		// resource id of the image
+		uint32_t image;
 		VkImageMemoryBarrier barrier = {};
 		vuk::PipelineStageFlags src;
 		vuk::PipelineStageFlags dst;
+		VkPipelineStageFlags2KHR src2 = 0;
+		VkPipelineStageFlags2KHR dst2 = 0;
+		// covers the single mip level and layer of the view the image is attached with (for attachments rendered to without a renderpass)
+		bool attachment_view = false;
 	};
 
 	struct MemoryBarrier {
 		VkMemoryBarrier barrier = {};
 		vuk::PipelineStageFlags src;
 		vuk::PipelineStageFlags dst;
+		VkPipelineStageFlags2KHR src2 = 0;
+		VkPipelineStageFlags2KHR dst2 = 0;
+	};
+
+	struct BufferBarrier {
+		// resource id of the buffer
+		uint32_t buffer;
+		VkBufferMemoryBarrier barrier = {};
+		vuk::PipelineStageFlags src;
+		vuk::PipelineStageFlags dst;
+		VkPipelineStageFlags2KHR src2 = 0;
+		VkPipelineStageFlags2KHR dst2 = 0;
+	};
+
+	// synchronization2 stages of a barrier
+	template<class B>
+	VkPipelineStageFlags2KHR src_stages2(const B& b) {
+		return b.src2 ? b.src2 : (VkPipelineStageFlags2KHR)(VkPipelineStageFlags)b.src;
+	}
+
+	template<class B>
+	VkPipelineStageFlags2KHR dst_stages2(const B& b) {
+		return b.dst2 ? b.dst2 : (VkPipelineStageFlags2KHR)(VkPipelineStageFlags)b.dst;
+	}
+
+	// the barriers of one boundary in synchronization2 form, each keeping its own stages
+	// image and buffer handles are left for the caller to fill in, the barriers are in the order of the input
+	struct DependencyInfo2 {
+		std::vector<VkMemoryBarrier2KHR> memory_barriers;
+		std::vector<VkImageMemoryBarrier2KHR> image_barriers;
+		std::vector<VkBufferMemoryBarrier2KHR> buffer_barriers;
+	};
+	DependencyInfo2 to_dependency_info(std::span<const ImageBarrier> image_barriers, std::span<const MemoryBarrier> mem_barriers, std::span<const BufferBarrier> buffer_barriers);
+
+	// a dependency between passes with other work recorded between them
+	// the producer sets an event, which the consumer waits on with the barriers, so the work in between can overlap
+	struct SplitBarrier {
+		// index into the events of the graph
+		size_t event;
+		// renderpass and subpass setting the event
+		size_t src_rp;
+		uint32_t src_subpass;
+		vuk::PipelineStageFlags src;
+		vuk::PipelineStageFlags dst;
+		std::vector<ImageBarrier> image_barriers;
+		std::vector<MemoryBarrier> mem_barriers;
 	};
 
 	struct SubpassInfo {
@@ -232,6 +334,10 @@ namespace vuk {
 		std::vector<ImageBarrier> pre_barriers;
 		std::vector<ImageBarrier> post_barriers;
 		std::vector<MemoryBarrier> pre_mem_barriers, post_mem_barriers;
+		// events set after the subpass (index, stages)
+		std::vector<std::pair<size_t, vuk::PipelineStageFlags>> set_events;
+		// events waited on before the subpass
+		std::vector<SplitBarrier> wait_events;
 	};
 
 	struct RenderPassInfo {
@@ -240,9 +346,34 @@ namespace vuk {
 		std::vector<AttachmentRPInfo, short_alloc<AttachmentRPInfo, 16>> attachments;
 		vuk::RenderPassCreateInfo rpci;
 		vuk::FramebufferCreateInfo fbci;
+		// memory dependencies for transients reusing the memory of earlier transients, issued before the renderpass
+		std::vector<MemoryBarrier> aliasing_barriers;
 		bool framebufferless = false;
+		// recorded with vkCmdBeginRendering, without handle and framebuffer
+		// the layout transitions and external dependencies of rpci are the pre- and post-barriers of its only subpass
+		bool dynamic_rendering = false;
 		VkRenderPass handle = {};
 		VkFramebuffer framebuffer;
+
+		Domain domain = Domain::eGraphics;
+		// index of the QueueBatch this renderpass is recorded into
+		size_t batch = 0;
+	};
+
+	// consecutive renderpasses submitted to the same queue
+	// batches alternate between graphics and compute, the first and the last batch are always graphics (and might be empty)
+	struct QueueBatch {
+		Domain domain;
+		size_t rp_begin, rp_end;
+
+		// queue family ownership transfers and layout transitions for uses coming from the other queue, recorded at the start of the batch
+		std::vector<ImageBarrier> acquire_barriers;
+		std::vector<BufferBarrier> acquire_buffer_barriers;
+		// ownership transfers for uses continuing on the other queue, recorded at the end of the batch
+		std::vector<ImageBarrier> release_barriers;
+		std::vector<BufferBarrier> release_buffer_barriers;
+		// earlier batches this batch waits on with a semaphore, and the stages that wait
+		std::vector<std::pair<size_t, vuk::PipelineStageFlags>> waits;
 	};
 
 } // namespace vuk
@@ -51,10 +51,15 @@ namespace vuk {
 		std::vector<VkAttachmentReference> resolve_refs;
 		std::vector<std::optional<VkAttachmentReference>> ds_refs;
 		std::vector<size_t> color_ref_offsets;
+		// input and preserved attachments, grouped by subpass like the color refs
+		std::vector<VkAttachmentReference> input_refs;
+		std::vector<size_t> input_ref_offsets;
+		std::vector<uint32_t> preserve_refs;
+		std::vector<size_t> preserve_ref_offsets;
 
 		bool operator==(const RenderPassCreateInfo& o) const {
-			return std::forward_as_tuple(flags, attachments, subpass_descriptions, subpass_dependencies, color_refs, color_ref_offsets, ds_refs, resolve_refs) ==
-				std::forward_as_tuple(o.flags, o.attachments, o.subpass_descriptions, o.subpass_dependencies, o.color_refs, o.color_ref_offsets, o.ds_refs, o.resolve_refs);
+			return std::forward_as_tuple(flags, attachments, subpass_descriptions, subpass_dependencies, color_refs, color_ref_offsets, ds_refs, resolve_refs, input_refs, input_ref_offsets, preserve_refs, preserve_ref_offsets) ==
+				std::forward_as_tuple(o.flags, o.attachments, o.subpass_descriptions, o.subpass_dependencies, o.color_refs, o.color_ref_offsets, o.ds_refs, o.resolve_refs, o.input_refs, o.input_ref_offsets, o.preserve_refs, o.preserve_ref_offsets);
 		}
 	};
 
@@ -91,7 +96,7 @@ namespace std {
 	struct hash<vuk::RenderPassCreateInfo> {
 		size_t operator()(vuk::RenderPassCreateInfo const& x) const noexcept {
 			size_t h = 0;
-			hash_combine(h, x.flags, x.attachments, x.color_refs, x.color_ref_offsets, x.ds_refs, x.subpass_dependencies, x.subpass_descriptions);
+			hash_combine(h, x.flags, x.attachments, x.color_refs, x.color_ref_offsets, x.ds_refs, x.subpass_dependencies, x.subpass_descriptions, x.input_refs, x.input_ref_offsets, x.preserve_refs, x.preserve_ref_offsets);
 			return h;
 		}
 	};
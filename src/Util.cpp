@@ -20,6 +20,8 @@ bool vuk::execute_submit_and_present_to_one(PerThreadContext& ptc, ExecutableRen
 	auto render_complete = ptc.acquire_semaphore();
 	std::vector<std::pair<SwapChainRef, size_t>> swapchains_with_indexes = { { swapchain, image_index } };
 
+	// execute submits the wait on the acquire, ahead of the first use of the image
+	rg.wait_for_swapchain(present_rdy, vuk::PipelineStageFlagBits::eColorAttachmentOutput);
 	auto cb = rg.execute(ptc, swapchains_with_indexes);
 
 	VkSubmitInfo si { .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO };
@@ -27,10 +29,6 @@ bool vuk::execute_submit_and_present_to_one(PerThreadContext& ptc, ExecutableRen
 	si.pCommandBuffers = &cb;
 	si.pSignalSemaphores = &render_complete;
 	si.signalSemaphoreCount = 1;
-	si.waitSemaphoreCount = 1;
-	si.pWaitSemaphores = &present_rdy;
-	VkPipelineStageFlags flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	si.pWaitDstStageMask = &flags;
 	auto fence = ptc.acquire_fence();
 	ptc.ctx.submit_graphics(si, fence);
 